@@ -5,8 +5,18 @@
 #include <algorithm>
 #include <atomic>
 #include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string_view>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_map>
 
 #include "../mio.hpp"
 #include "../gsl-lite.hpp"
@@ -15,6 +25,9 @@
 #include "correct.hpp"
 #include "consts.hpp"
 #include "analysis.hpp"
+#include "options.hpp"
+#include "stream.hpp"
+#include "direct.hpp"
 
 namespace d88::api
 {
@@ -43,18 +56,138 @@ namespace d88::api
 		return t;
 	}
 
+	//Contexts never change once built so workers share them, keyed by the digest of the key and the context type (which carries T and S).
+	//Each entry is charged the Footprint() its context reports, least recently used entries are dropped once the total passes the budget.
+	//
+
+	class context_cache
+	{
+	public:
+		struct stats_t
+		{
+			size_t hits = 0;
+			size_t misses = 0;
+			size_t evictions = 0;
+			size_t bytes = 0;
+			size_t entries = 0;
+		};
+
+		context_cache(size_t budget = 64 * 1024 * 1024) : limit(budget) {}
+
+		template <typename C, typename T, size_t S> std::shared_ptr<const C> Get(std::string_view key)
+		{
+			auto id = picosha2::hash256_hex_string(key.begin(), key.end()) + typeid(C).name();
+
+			{
+				std::lock_guard<std::mutex> lock(m);
+
+				auto it = index.find(id);
+				if (it != index.end())
+				{
+					lru.splice(lru.begin(), lru, it->second);
+					stats.hits++;
+
+					return std::static_pointer_cast<const C>(it->second->context);
+				}
+
+				stats.misses++;
+			}
+
+			auto sym = StringAsSymmetry<T, S>(key);
+			std::shared_ptr<const C> context = std::make_shared<const C>(sym);
+			size_t bytes = context->Footprint();
+
+			std::lock_guard<std::mutex> lock(m);
+
+			auto it = index.find(id);
+			if (it != index.end())
+				return std::static_pointer_cast<const C>(it->second->context);
+
+			if (bytes <= limit)
+			{
+				lru.push_front({ id, context, bytes });
+				index[id] = lru.begin();
+				stats.bytes += bytes;
+
+				Trim();
+			}
+
+			return context;
+		}
+
+		void Budget(size_t budget)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			limit = budget;
+			Trim();
+		}
+
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			lru.clear();
+			index.clear();
+			stats = stats_t();
+		}
+
+		stats_t Stats()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			auto result = stats;
+			result.entries = lru.size();
+
+			return result;
+		}
+
+	private:
+		struct entry_t
+		{
+			std::string id;
+			std::shared_ptr<const void> context;
+			size_t bytes;
+		};
+
+		void Trim()
+		{
+			while (stats.bytes > limit && lru.size())
+			{
+				stats.bytes -= lru.back().bytes;
+				stats.evictions++;
+
+				index.erase(lru.back().id);
+				lru.pop_back();
+			}
+		}
+
+		std::mutex m;
+		size_t limit;
+		stats_t stats;
+
+		std::list<entry_t> lru;
+		std::unordered_map<std::string, std::list<entry_t>::iterator> index;
+	};
+
+	inline context_cache& default_context_cache()
+	{
+		static context_cache cache;
+
+		return cache;
+	}
+
 	//(?) Analysis needs to solve the INVERSE problem for the constant part of the poly before this becomes 100%, and ready for use.
 	//(X) Solved with padded extract symmetry.
 	//
 
-	void generate_static(std::string_view _a, std::string_view _b, std::string_view _s,bool parallel = true)
+	void generate_static(std::string_view _a, std::string_view _b, std::string_view _s, const options_t& options = options_t())
 	{
 		constexpr unsigned blocks = 128;
 		constexpr unsigned chunk = 1024;
 		using T = uint64_t;
 
-		PascalTriangle<T> pt(blocks+1);
-		vector<T> temp(blocks+1);
+		auto pt = GeneratePascal<T, blocks + 1>();
 
 		//Alignment not supported ATM, much more complicated with three files.
 		mio::mmap_source a(_a);
@@ -71,26 +204,17 @@ namespace d88::api
 		allocate_file(_s, a.size()+chunks*sizeof(T));
 		mio::mmap_sink result(_s);	
 
-		if (parallel)
+		ParallelFor(chunks, options, [&](size_t, size_t first, size_t last)
 		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, a.data(), chunks, [&](auto v)
-			{
-				auto i = identity++;
-
-				vector<T> temp(blocks+1);
+			ScratchFrame scratch;
+			auto temp = scratch.Take<T>(blocks + 1);
 
+			for (size_t i = first; i < last; i++)
 				d88::analysis::padded_symmetry<T>(gsl::span<T>((T*)(b.data() + i*chunk), blocks), gsl::span<T>((T*)(a.data() + i*chunk), blocks), temp, gsl::span<T>((T*)(result.data() + i*(chunk+sizeof(T))), blocks+1), pt);
-			});
-		}
-		else
-		{
-			for (size_t i = 0, k = 0; i < a.size(); k++, i += chunk)
-				d88::analysis::padded_symmetry<T>(gsl::span<T>((T*)(b.data() + i), blocks), gsl::span<T>((T*)(a.data() + i), blocks), temp, gsl::span<T>((T*)(result.data() + i+ k* sizeof(T)), blocks+1), pt);
-		}
+		});
 	}
 
-	void forward_static(std::string_view _a, std::string_view _s, std::string_view _r, bool parallel = true)
+	void forward_static(std::string_view _a, std::string_view _s, std::string_view _r, const options_t& options = options_t())
 	{
 		constexpr unsigned blocks = 128;
 		constexpr unsigned chunk = 1024;
@@ -110,28 +234,21 @@ namespace d88::api
 		allocate_file(_r, a.size());
 		mio::mmap_sink r(_r);
 
-		if (parallel)
+		ParallelFor(chunks, options, [&](size_t, size_t first, size_t last)
 		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, a.data(), chunks, [&](auto v)
+			ElectiveSymmetry<T> es(gsl::span<T>((T*)(s.data() + first * (chunk + sizeof(T))), blocks + 1));
+
+			for (size_t i = first; i < last; i++)
 			{
-				auto i = identity++;
+				if (i != first)
+					es.Assign(gsl::span<T>((T*)(s.data() + i * (chunk + sizeof(T))), blocks + 1));
 
-				ElectiveSymmetry<T> es(gsl::span<T>((T*)(s.data() + i * (chunk + sizeof(T))), blocks + 1));
 				ToFunctionR<T>(d88::analysis::shim_span<T>((T*)(a.data() + i * chunk), blocks), gsl::span<T>((T*)(r.data() + i * chunk), blocks), es,1);
-			});
-		}
-		else
-		{
-			for (size_t i = 0, k = 0; i < a.size(); k++, i += chunk)
-			{
-				ElectiveSymmetry<T> es(gsl::span<T>((T*)(s.data() + i +k*sizeof(T)), blocks + 1));
-				ToFunctionR<T>(d88::analysis::shim_span<T>((T*)(a.data() + i), blocks), gsl::span<T>((T*)(r.data() + i), blocks), es,1);
 			}
-		}
+		});
 	}
 
-	void reverse_static(std::string_view _a, std::string_view _s, std::string_view _r, bool parallel = true)
+	void reverse_static(std::string_view _a, std::string_view _s, std::string_view _r, const options_t& = options_t())
 	{
 
 	}
@@ -167,361 +284,1646 @@ namespace d88::api
 
 		std::ofstream s("es.txt");
 
-		for (auto& e : y.data())
+		for (size_t i = y.first(); i < y.size(); i++)
 		{
 			//todo
 		}
 	}
 
-	void default_encrypt(std::string_view i, std::string_view o, std::string_view k,bool parallel = true)
+	//Chunks handed to one task, rounded up to whole lane groups so the multi chunk kernels never split a batch.
+	//
+
+	template <typename T> size_t multi_grain(size_t chunks, size_t workers, size_t grain)
 	{
-		constexpr unsigned blocks = 128;
-		constexpr unsigned chunk = 1024;
-		using T = uint64_t;
+		size_t lanes = simd::Lanes<T>();
+		if (lanes < 1) lanes = 1;
 
-		vector<T> temp(blocks);
+		if (!grain)
+			grain = chunks / (workers * 8);
 
-		auto sym = StringAsSymmetry<T, blocks>(k);
-		d88::security::EncryptContextLong<T, blocks> ec(sym);
+		if (grain < lanes)
+			return lanes;
 
-		mio::mmap_source file(i);
-		size_t rem = (file.size() % chunk);
+		return (grain + lanes - 1) / lanes * lanes;
+	}
 
-		allocate_file(o, (rem) ? (file.size()+rem + sizeof(uint64_t)) : file.size());
-		mio::mmap_sink result(o);
+	//A protection profile is one chunk layout compiled ahead of time: words of T, blocks words per stripe with rec recovery and val check words each,
+	//and stripes interleaved so word j of a chunk belongs to stripe j % stripes. Interleaving spreads a burst over every stripe, so a chunk survives
+	//stripes * rec damaged words in a row at the parity ratio of one stripe. Stripes use the first blocks words of the default symmetry.
+	//
 
-		if (parallel)
-		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, file.data(), file.size() / chunk, [&](auto v)
-			{
-				auto i = identity++;
+	template <typename W, size_t S, size_t R, size_t V, size_t L = 1> struct profile_t
+	{
+		using T = W;
 
-				vector<T> temp(blocks);
+		static constexpr size_t blocks = S;
+		static constexpr size_t rec = R;
+		static constexpr size_t val = V;
+		static constexpr size_t stripes = L;
+		static constexpr size_t chunk = S * L * sizeof(T);
+		static constexpr size_t parity = (R + V) * L * sizeof(T);
 
-				d88::security::block_encrypt_long<T, blocks>(gsl::span<T>((T*)(file.data() + i * chunk), blocks), temp, gsl::span<T>((T*)(result.data() + i * chunk), blocks), ec);
-			});
-		}
-		else
+		static constexpr size_t Chunks(size_t size) { return (size + chunk - 1) / chunk; }
+
+		static_assert(S <= std::tuple_size_v<decltype(consts::default_symmetry)>);
+
+		static span<T> Symmetry()
 		{
-			for (size_t i = 0; i < file.size() - rem; i += chunk)
-				d88::security::block_encrypt_long<T, blocks>(gsl::span<T>((T*)(file.data() + i), blocks), temp, gsl::span<T>((T*)(result.data() + i), blocks), ec);
-		}
+			static auto sym = []()
+			{
+				std::array<T, S> result;
 
+				for (size_t i = 0; i < S; i++)
+					result[i] = T(consts::default_symmetry[i]);
 
-		//Padding:
-		//
+				return result;
+			}();
 
-		if (rem)
+			return span<T>(sym.data(), S);
+		}
+
+		static const std::array<uint8_t, 32>& Digest()
 		{
-			std::vector<uint8_t> tmp = d8u::random::Vector<uint8_t>(chunk), tout(chunk);
+			static auto digest = []()
+			{
+				std::array<uint8_t, 32> result;
+				auto sym = Symmetry();
 
-			std::copy(file.end() - rem, file.end(), tmp.begin());
+				picosha2::hash256((const uint8_t*)sym.data(), (const uint8_t*)(sym.data() + S), result.begin(), result.end());
 
-			d88::security::block_encrypt_long<T, blocks>(gsl::span<T>((T*)(tmp.data()), blocks), temp, gsl::span<T>((T*)(tout.data()), blocks), ec);
+				return result;
+			}();
 
-			std::copy(tout.begin(), tout.end(), result.end() - (chunk + sizeof(uint64_t)));
+			return digest;
+		}
 
-			*(uint64_t*)(result.data() + result.size() - sizeof(uint64_t)) = file.size();
+		static d88::correct::ImmutableShortContext<T, S, R>& Context()
+		{
+			return singleton_context<d88::correct::ImmutableShortContext<T, S, R>>(Symmetry());
 		}
-	}
 
-	void default_decrypt(std::string_view i, std::string_view o, std::string_view k, bool parallel = true)
-	{
-		constexpr unsigned blocks = 128;
-		constexpr unsigned chunk = 1024;
-		using T = uint64_t;
+		static d88::correct::RepairPlan<T, S, R, V>& Plan()
+		{
+			return singleton_context<d88::correct::RepairPlan<T, S, R, V>>(Symmetry());
+		}
+	};
 
-		auto sym = StringAsSymmetry<T, blocks>(k);
-		d88::security::DecryptContextShort<T, blocks> dc(sym);
+	//The table options.profile indexes, entry 0 is the original layout. Ids are stored in parity files so entries are only ever appended.
+	//
 
-		mio::mmap_source file(i);
+	using profile_table = std::tuple<
+		profile_t<uint64_t, 512, 14, 2>,
+		profile_t<uint64_t, 128, 6, 2>,
+		profile_t<uint64_t, 512, 14, 2, 4>,
+		profile_t<uint64_t, 512, 14, 2, 16>,
+		profile_t<uint64_t, 512, 6, 2>,
+		profile_t<uint32_t, 512, 14, 2, 2>>;
 
-		auto final_size = ((file.size() % chunk) ? (*(uint64_t*)(file.data() + file.size() - sizeof(uint64_t))) : file.size());
+	constexpr size_t profile_count = std::tuple_size_v<profile_table>;
 
-		allocate_file(o, final_size);
-		mio::mmap_sink result(o);
+	constexpr std::array<std::string_view, profile_count> profile_names = { "4k", "1k", "16k", "64k", "4k-lean", "4k32" };
 
-		size_t rem = (result.size() % chunk);
+	//Calls f with a default constructed profile_t of entry id, every entry is instantiated once per call site.
+	//
 
-		if (parallel)
-		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, file.data(), result.size() / chunk, [&](auto v)
-			{
-				auto i = identity++;
-				d88::security::block_decrypt_short<T, blocks>(gsl::span<T>((T*)(file.data() + i * chunk), blocks), gsl::span<T>((T*)(result.data() + i * chunk), blocks), dc);
-			});
-		}
-		else
+	template <size_t I = 0, typename F> decltype(auto) with_profile(size_t id, F&& f)
+	{
+		if constexpr (I + 1 < profile_count)
 		{
-			for (size_t i = 0; i < result.size() - rem; i += chunk)
-				d88::security::block_decrypt_short<T, blocks>(gsl::span<T>((T*)(file.data() + i), blocks), gsl::span<T>((T*)(result.data() + i), blocks), dc);
+			if (id != I)
+				return with_profile<I + 1>(id, std::forward<F>(f));
 		}
+		else if (id != I)
+			throw "Unknown protection profile.";
 
-		//Padding:
-		//
+		return f(std::tuple_element_t<I, profile_table>());
+	}
 
-		if (rem)
+	struct protection_profile
+	{
+		std::string_view name;
+		size_t word = 0;
+		size_t blocks = 0;
+		size_t rec = 0;
+		size_t val = 0;
+		size_t stripes = 0;
+		size_t chunk = 0;
+		size_t parity = 0;
+	};
+
+	inline protection_profile describe_profile(size_t id)
+	{
+		return with_profile(id, [&](auto p)
 		{
-			std::vector<uint8_t> tmp(chunk);
+			using P = decltype(p);
 
-			d88::security::block_decrypt_short<T, blocks>(gsl::span<T>((T*)(file.end()-(chunk+sizeof(uint64_t))), blocks), gsl::span<T>((T*)(tmp.data()), blocks), dc);
-
-			std::copy(tmp.begin(), tmp.begin() + rem, result.end() - rem);
-		}
+			return protection_profile{ profile_names[id], sizeof(typename P::T), P::blocks, P::rec, P::val, P::stripes, P::chunk, P::parity };
+		});
 	}
 
-	void default_protect(std::string_view name,std::string_view output, bool parallel = true)
+	inline size_t find_profile(std::string_view name)
 	{
-		constexpr unsigned blocks = 512;
-		constexpr unsigned rec = 14;
-		constexpr unsigned val = 2;
-		constexpr unsigned chunk = 4096;
-		using T = uint64_t;
-
-		auto ectx = singleton_context<d88::correct::ImmutableShortContext<T, blocks, rec>>(consts::default_symmetry);
+		for (size_t i = 0; i < profile_count; i++)
+			if (profile_names[i] == name)
+				return i;
 
-		vector<T> temp(blocks);
+		throw "Unknown protection profile.";
+	}
 
-		mio::mmap_source file(name);
-		size_t rem = file.size() % chunk;
+	//Stripe s of chunk i as blocks words, read only over a const source. A whole word aligned single stripe chunk is used in place,
+	//anything interleaved, short or misaligned is gathered into out with zero padding.
+	//
 
-		auto final_size = file.size() / chunk;
-		if (rem) final_size++;
-		final_size *= (rec + val) * sizeof(T);
+	template <typename P, typename B> auto load_stripe(gsl::span<B> source, size_t i, size_t s, gsl::span<typename P::T> out)
+	{
+		using T = typename P::T;
+		using W = std::conditional_t<std::is_const_v<B>, const T, T>;
 
-		allocate_file(output, final_size);
-		mio::mmap_sink result(output);
+		B* base = source.data() + i * P::chunk;
+		size_t avail = std::min(P::chunk, source.size() - i * P::chunk);
 
-		if (parallel)
+		if (avail == P::chunk && !((size_t)base % alignof(T)))
 		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, file.data(), file.size() / chunk, [&](auto v)
-			{
-				auto i = identity++;
-				vector<T> temp(blocks);
+			if constexpr (P::stripes == 1)
+				return gsl::span<W>((W*)base, P::blocks);
 
-				d88::correct::immutable_extend_short<T, blocks, rec, val>(gsl::span<T>((T*)(file.data() + i * chunk), blocks), temp, gsl::span<T>((T*)(result.data() + i * (rec + val) * sizeof(T)), rec + val), ectx);
-			});
+			for (size_t j = 0; j < P::blocks; j++)
+				out[j] = ((const T*)base)[j * P::stripes + s];
+
+			return gsl::span<W>(out);
 		}
-		else
+
+		for (size_t j = 0; j < P::blocks; j++)
 		{
-			for (size_t i = 0, k = 0; i < file.size() - rem; k++, i += chunk)
-				d88::correct::immutable_extend_short<T, blocks, rec, val>(gsl::span<T>((T*)(file.data() + i), blocks), temp, gsl::span<T>((T*)(result.data() + k * (rec + val) * sizeof(T)), rec+val), ectx);
+			size_t at = (j * P::stripes + s) * sizeof(T);
+
+			out[j] = 0;
+
+			if (at < avail)
+				std::memcpy(&out[j], base + at, std::min(sizeof(T), avail - at));
 		}
 
-		//Padding:
-		//
+		return gsl::span<W>(out);
+	}
 
-		if (rem)
-		{
-			std::vector<uint8_t> tmp(chunk);
+	//Writes a repaired stripe back, a no-op for a stripe load_stripe handed out in place:
+	//
 
-			for (size_t i = 0; i < chunk; i++)
-				tmp[i] = 0;
+	template <typename P> void store_stripe(gsl::span<uint8_t> source, size_t i, size_t s, gsl::span<const typename P::T> words)
+	{
+		using T = typename P::T;
+
+		uint8_t* base = source.data() + i * P::chunk;
+		size_t avail = std::min(P::chunk, source.size() - i * P::chunk);
+
+		if ((const uint8_t*)words.data() == base)
+			return;
 
-			std::copy(file.end() - rem, file.end(), tmp.begin());
+		for (size_t j = 0; j < P::blocks; j++)
+		{
+			size_t at = (j * P::stripes + s) * sizeof(T);
 
-			d88::correct::immutable_extend_short<T, blocks, rec, val>(gsl::span<T>((T*)tmp.data(), blocks), temp, gsl::span<T>((T*)(result.end() - (rec + val) * sizeof(T)), blocks), ectx);
+			if (at < avail)
+				std::memcpy(base + at, &words[j], std::min(sizeof(T), avail - at));
 		}
 	}
 
-	void default_recover(std::string_view name, std::string_view _check, bool parallel = true)
+	//The rec + val parity words of stripe s of chunk i are copied in and out, parity buffers need not be word aligned:
+	//
+
+	template <typename P> gsl::span<typename P::T> load_parity(gsl::span<const uint8_t> parity, size_t i, size_t s, gsl::span<typename P::T> out)
 	{
-		constexpr unsigned blocks = 512;
-		constexpr unsigned rec = 14;
-		constexpr unsigned val = 2;
-		constexpr unsigned chunk = 4096;
-		using T = uint64_t;
-		auto& sym = consts::default_symmetry;
+		constexpr size_t words = P::rec + P::val;
 
-		auto ectx = singleton_context<d88::correct::ImmutableShortContext<T, blocks, rec>>(consts::default_symmetry);
-		vector<T> temp(blocks),temp2(blocks);
-		vector<T> ex_temp(rec + val);
+		std::memcpy(out.data(), parity.data() + i * P::parity + s * words * sizeof(typename P::T), words * sizeof(typename P::T));
 
-		mio::mmap_sink file(name);
-		mio::mmap_source check(_check);
+		return out;
+	}
 
-		size_t rem = file.size() % chunk;
+	template <typename P> void store_parity(gsl::span<uint8_t> parity, size_t i, size_t s, gsl::span<const typename P::T> in)
+	{
+		constexpr size_t words = P::rec + P::val;
 
-		auto do_validate_and_recover = [&](auto k,auto blk,auto ex,auto &_temp,auto &_temp2,auto &_ex_temp)
-		{
-			if (!d88::correct::validate_immutable_short<T, blocks, rec, val>(blk, _temp, ex, _ex_temp, ectx))
-			{
-				std::cout << "Validation Failed for Chunk " << k << std::endl;
+		std::memcpy(parity.data() + i * P::parity + s * words * sizeof(typename P::T), in.data(), words * sizeof(typename P::T));
+	}
 
-				if (!d88::correct::repair_quick2<T, blocks, rec, 1, val>(blk, _temp, _temp2, ex, _ex_temp, sym, ectx))
-				{
-					std::cout << "Unrecoverable block " << k * chunk << " => " << k * chunk + chunk << std::endl;
-					return -1;
-				}	
-				else
-				{
-					std::cout << "Recovered Block!" << std::endl;
-					return 1;
-				}
-			}
+	//Streaming forms keep a ring of stream_depth slots, one being read, one transformed and one written with a spare to absorb jitter.
+	//
 
-			return 0;
-		};
+	constexpr size_t stream_buffer = 1 << 20;
+	constexpr size_t stream_depth = 4;
 
-		if (parallel)
-		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, file.data(), file.size() / chunk, [&](auto v)
-			{
-				auto i = identity++;
-				vector<T> temp(blocks), temp2(blocks);
-				vector<T> ex_temp(rec + val);
+	inline size_t stream_chunks(size_t chunk, const options_t& options)
+	{
+		size_t n = ((options.buffer) ? options.buffer : stream_buffer) / chunk;
 
-				do_validate_and_recover(i, gsl::span<T>((T*)(file.data() + i * chunk), blocks), gsl::span<T>((T*)(check.data() + i * (rec + val) * sizeof(T)), rec + val), temp, temp2, ex_temp);
-			});
-		}
+		return (n) ? n : 1;
+	}
+
+	//Every chunked encrypt and decrypt goes through these, with options.tweak the chunks are whitened by their index from the start of the plain text.
+	//
+
+	inline std::unique_ptr<d88::security::TweakKey> chunk_tweak(std::string_view k, const options_t& options)
+	{
+		return (options.tweak) ? std::make_unique<d88::security::TweakKey>(k) : nullptr;
+	}
+
+	template <typename T, size_t S> void encrypt_chunks(gsl::span<const T> source, gsl::span<T> dest, const d88::security::EncryptContextLong<T, S>& context, const d88::security::TweakKey* tweak, size_t first)
+	{
+		if (tweak)
+			d88::security::multi_block_encrypt_tweaked<T, S>(source, dest, context, *tweak, first);
 		else
-		{
-			for (size_t i = 0, k = 0; i < file.size() - rem; i += chunk, k++)
-				do_validate_and_recover(k, gsl::span<T>((T*)(file.data() + i), blocks), gsl::span<T>((T*)(check.data() + k * (rec + val) * sizeof(T)), rec + val), temp, temp2, ex_temp);
-		}
+			d88::security::multi_block_encrypt_long<T, S>(source, dest, context);
+	}
 
-		//Padding:
-		//
+	template <typename T, size_t S> void decrypt_chunks(gsl::span<const T> source, gsl::span<T> dest, const d88::security::DecryptContextShort<T, S>& context, const d88::security::TweakKey* tweak, size_t first)
+	{
+		if (tweak)
+			d88::security::multi_block_decrypt_tweaked<T, S>(source, dest, context, *tweak, first);
+		else
+			d88::security::multi_block_decrypt_short<T, S>(source, dest, context);
+	}
 
-		if (rem)
+	constexpr size_t staging_chunks = 64;
+
+	//Runs f(source words, dest words, k) over n chunks of S words from source into dest, k the first chunk of each call.
+	//Caller buffers may start anywhere, a side that is not word aligned goes through scratch runs of staging_chunks and is copied across.
+	//
+
+	template <typename T, size_t S, typename F> void staged_chunks(const uint8_t* source, uint8_t* dest, size_t n, F&& f)
+	{
+		constexpr size_t chunk = S * sizeof(T);
+
+		bool in = !((size_t)source % alignof(T)), out = !((size_t)dest % alignof(T));
+
+		if (in && out)
+			return f(gsl::span<const T>((const T*)source, n * S), gsl::span<T>((T*)dest, n * S), 0);
+
+		ScratchFrame scratch;
+		size_t most = std::min(n, staging_chunks) * S;
+		auto a = scratch.Take<T>((in) ? 0 : most), b = scratch.Take<T>((out) ? 0 : most);
+
+		for (size_t k = 0; k < n; k += staging_chunks)
 		{
-			std::vector<uint8_t> tmp(chunk);
+			size_t run = std::min(staging_chunks, n - k);
 
-			for (size_t i = 0; i < chunk; i++)
-				tmp[i] = 0;
+			if (!in)
+				std::memcpy(a.data(), source + k * chunk, run * chunk);
 
-			std::copy(file.end() - rem, file.end(), tmp.begin());
+			f((in) ? gsl::span<const T>((const T*)(source + k * chunk), run * S) : gsl::span<const T>(a.data(), run * S),
+				(out) ? gsl::span<T>((T*)(dest + k * chunk), run * S) : b.subspan(0, run * S), k);
 
-			if(1 == do_validate_and_recover(-1, gsl::span<T>((T*)(tmp.data()), blocks), gsl::span<T>((T*)(check.data() + check.size() - (rec + val) * sizeof(T)), rec + val), temp, temp2, ex_temp))
-				std::copy(tmp.begin(), tmp.begin() + rem, file.end() - rem);
+			if (!out)
+				std::memcpy(dest + k * chunk, b.data(), run * chunk);
 		}
 	}
 
-	template <typename B> std::vector<uint8_t> protect_block(const B& block, bool parallel = true)
+	//Same format as default_encrypt, but reads and writes sequentially in bounded memory, "-" selects stdin or stdout.
+	//With options.direct files go through O_DIRECT + io_uring instead of stdio.
+	//
+
+	void stream_encrypt(std::string_view i, std::string_view o, std::string_view k, const options_t& options = options_t())
 	{
-		constexpr unsigned blocks = 512;
-		constexpr unsigned rec = 14;
-		constexpr unsigned val = 2;
-		constexpr unsigned chunk = 4096;
+		constexpr unsigned blocks = 128;
+		constexpr unsigned chunk = 1024;
 		using T = uint64_t;
 
-		auto ectx = singleton_context<d88::correct::ImmutableShortContext<T, blocks, rec>>(consts::default_symmetry);
+		auto context = default_context_cache().Get<d88::security::EncryptContextLong<T, blocks>, T, blocks>(k);
+		auto& ec = *context;
+		auto tweak = chunk_tweak(k, options);
 
-		vector<T> temp(blocks);
+		auto in = OpenStream(i, false, options), out = OpenStream(o, true, options);
 
-		size_t rem = block.size() % chunk;
+		auto& pool = SharedPool(options);
+		size_t batch = stream_chunks(chunk, options) * chunk, offset = 0;
 
-		auto final_size = block.size() / chunk;
-		if (rem) final_size++;
-		final_size *= (rec + val) * sizeof(T);
+		std::vector<stream_slot_t> ring(stream_depth);
 
-		std::vector result(final_size);
+		for (auto& slot : ring)
+		{
+			slot.in.resize(batch);
+			slot.out.resize(batch + chunk + sizeof(uint64_t));
+		}
+
+		StreamPipeline(ring, [&](stream_slot_t& slot)
+		{
+			slot.size = in->Read(slot.in.data(), batch);
+			slot.offset = offset;
+			offset += slot.size;
 
-		if (parallel)
+			return slot.size == batch;
+		},
+		[&](stream_slot_t& slot)
 		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, block.data(), block.size() / chunk, [&](auto v)
+			size_t chunks = slot.size / chunk, rem = slot.size % chunk;
+
+			pool.For(chunks, multi_grain<T>(chunks, pool.size(), options.grain), [&](size_t, size_t first, size_t last)
 			{
-				auto i = identity++;
-				vector<T> temp(blocks);
+				auto n = last - first;
 
-				d88::correct::immutable_extend_short<T, blocks, rec, val>(gsl::span<T>((T*)(block.data() + i * chunk), blocks), temp, gsl::span<T>((T*)(result.data() + i * (rec + val) * sizeof(T)), rec + val), ectx);
+				encrypt_chunks<T, blocks>(gsl::span<T>((T*)(slot.in.data() + first * chunk), n * blocks), gsl::span<T>((T*)(slot.out.data() + first * chunk), n * blocks), ec, tweak.get(), slot.offset / chunk + first);
 			});
-		}
-		else
-		{
-			for (size_t i = 0, k = 0; i < block.size() - rem; k++, i += chunk)
-				d88::correct::immutable_extend_short<T, blocks, rec, val>(gsl::span<T>((T*)(block.data() + i), blocks), temp, gsl::span<T>((T*)(result.data() + k * (rec + val) * sizeof(T)), rec + val), ectx);
-		}
 
-		//Padding:
-		//
+			slot.out_size = chunks * chunk;
 
-		if (rem)
-		{
-			std::vector<uint8_t> tmp(chunk);
+			//Padding, only the last slot can come up short:
+			//
 
-			for (size_t i = 0; i < chunk; i++)
-				tmp[i] = 0;
+			if (rem)
+			{
+				std::vector<uint8_t> tmp = d8u::random::Vector<uint8_t>(chunk);
 
-			std::copy(block.end() - rem, block.end(), tmp.begin());
+				std::copy(slot.in.begin() + slot.out_size, slot.in.begin() + slot.size, tmp.begin());
 
-			d88::correct::immutable_extend_short<T, blocks, rec, val>(gsl::span<T>((T*)tmp.data(), blocks), temp, gsl::span<T>((T*)(result.end() - (rec + val) * sizeof(T)), blocks), ectx);
-		}
+				encrypt_chunks<T, blocks>(gsl::span<T>((T*)(tmp.data()), blocks), gsl::span<T>((T*)(slot.out.data() + slot.out_size), blocks), ec, tweak.get(), slot.offset / chunk + chunks);
 
-		return result;
+				*(uint64_t*)(slot.out.data() + slot.out_size + chunk) = slot.offset + slot.size;
+
+				slot.out_size += chunk + sizeof(uint64_t);
+			}
+		},
+		[&](stream_slot_t& slot)
+		{
+			out->Write(slot.out.data(), slot.out_size);
+		});
+
+		out->Flush();
 	}
 
-	template <typename B, typename C> bool recover_block(const B& block, const C& check, bool parallel = true)
+	//The padded tail is only recognisable at the end of the stream, so the reader always holds back one tail's worth of bytes for the next slot.
+	//
+
+	void stream_decrypt(std::string_view i, std::string_view o, std::string_view k, const options_t& options = options_t())
 	{
-		bool valid = true;
-		constexpr unsigned blocks = 512;
-		constexpr unsigned rec = 14;
-		constexpr unsigned val = 2;
-		constexpr unsigned chunk = 4096;
+		constexpr unsigned blocks = 128;
+		constexpr unsigned chunk = 1024;
+		constexpr unsigned tail = chunk + sizeof(uint64_t);
 		using T = uint64_t;
-		auto& sym = consts::default_symmetry;
 
-		auto ectx = singleton_context<d88::correct::ImmutableShortContext<T, blocks, rec>>(consts::default_symmetry);
-		vector<T> temp(blocks), temp2(blocks);
-		vector<T> ex_temp(rec + val);
+		auto context = default_context_cache().Get<d88::security::DecryptContextShort<T, blocks>, T, blocks>(k);
+		auto& dc = *context;
+		auto tweak = chunk_tweak(k, options);
+
+		auto in = OpenStream(i, false, options), out = OpenStream(o, true, options);
+
+		auto& pool = SharedPool(options);
+		size_t batch = stream_chunks(chunk, options) * chunk, offset = 0, held = 0;
+
+		std::vector<stream_slot_t> ring(stream_depth);
+		std::vector<uint8_t> carry(tail);
+
+		for (auto& slot : ring)
+		{
+			slot.in.resize(batch + tail);
+			slot.out.resize(batch + tail);
+		}
+
+		StreamPipeline(ring, [&](stream_slot_t& slot)
+		{
+			std::copy(carry.begin(), carry.begin() + held, slot.in.begin());
 
-		size_t rem = block.size() % chunk;
+			slot.size = held + in->Read(slot.in.data() + held, batch + tail - held);
+			slot.offset = offset;
 
-		auto do_validate_and_recover = [&](auto k, auto blk, auto ex, auto& _temp, auto& _temp2, auto& _ex_temp)
+			if (slot.size < batch + tail)
+				return false;
+
+			std::copy(slot.in.begin() + batch, slot.in.begin() + batch + tail, carry.begin());
+
+			held = tail;
+			slot.size = batch;
+			offset += batch;
+
+			return true;
+		},
+		[&](stream_slot_t& slot)
 		{
-			if (!d88::correct::validate_immutable_short<T, blocks, rec, val>(blk, _temp, ex, _ex_temp, ectx))
+			size_t body = slot.size;
+			bool padded = slot.last && slot.size % chunk == sizeof(uint64_t);
+
+			if (padded)
 			{
-				if (!d88::correct::repair_quick2<T, blocks, rec, 1, val>(blk, _temp, _temp2, ex, _ex_temp, sym, ectx))
-				{
-					valid = false;
-					return -1;
-				}
-				else
-					return 1;
+				if (slot.size < tail)
+					throw "Stream is too short for its padding.";
+
+				body -= tail;
 			}
 
-			return 0;
-		};
+			if (body % chunk)
+				throw "Stream is not a whole number of chunks.";
 
-		if (parallel)
-		{
-			std::atomic<size_t> identity = 0;
-			for_each_n(execution::par_unseq, block.data(), block.size() / chunk, [&](auto v)
+			size_t chunks = body / chunk;
+
+			pool.For(chunks, multi_grain<T>(chunks, pool.size(), options.grain), [&](size_t, size_t first, size_t last)
 			{
-				auto i = identity++;
-				vector<T> temp(blocks), temp2(blocks);
-				vector<T> ex_temp(rec + val);
+				auto n = last - first;
 
-				do_validate_and_recover(i, gsl::span<T>((T*)(block.data() + i * chunk), blocks), gsl::span<T>((T*)(check.data() + i * (rec + val) * sizeof(T)), rec + val), temp, temp2, ex_temp);
+				decrypt_chunks<T, blocks>(gsl::span<T>((T*)(slot.in.data() + first * chunk), n * blocks), gsl::span<T>((T*)(slot.out.data() + first * chunk), n * blocks), dc, tweak.get(), slot.offset / chunk + first);
 			});
-		}
-		else
-		{
-			for (size_t i = 0, k = 0; i < block.size() - rem; i += chunk, k++)
-				do_validate_and_recover(k, gsl::span<T>((T*)(block.data() + i), blocks), gsl::span<T>((T*)(check.data() + k * (rec + val) * sizeof(T)), rec + val), temp, temp2, ex_temp);
-		}
 
-		//Padding:
-		//
+			slot.out_size = body;
 
-		if (rem)
-		{
-			std::vector<uint8_t> tmp(chunk);
+			//Padding:
+			//
 
-			for (size_t i = 0; i < chunk; i++)
-				tmp[i] = 0;
+			if (padded)
+			{
+				uint64_t final_size = *(uint64_t*)(slot.in.data() + slot.size - sizeof(uint64_t));
+				uint64_t whole = slot.offset + body;
 
-			std::copy(block.end() - rem, block.end(), tmp.begin());
+				if (final_size <= whole || final_size - whole >= chunk)
+					throw "Stream length does not match its trailer.";
 
-			if (1 == do_validate_and_recover(-1, gsl::span<T>((T*)(tmp.data()), blocks), gsl::span<T>((T*)(check.data() + check.size() - (rec + val) * sizeof(T)), rec + val), temp, temp2, ex_temp))
-				std::copy(tmp.begin(), tmp.begin() + rem, block.end() - rem);
-		}
+				ScratchFrame scratch;
+				auto tmp = scratch.Take<uint8_t>(chunk);
 
-		return valid;
+				decrypt_chunks<T, blocks>(gsl::span<T>((T*)(slot.in.data() + body), blocks), gsl::span<T>((T*)(tmp.data()), blocks), dc, tweak.get(), slot.offset / chunk + chunks);
+
+				std::copy(tmp.begin(), tmp.begin() + (final_size - whole), slot.out.begin() + body);
+
+				slot.out_size += final_size - whole;
+			}
+		},
+		[&](stream_slot_t& slot)
+		{
+			out->Write(slot.out.data(), slot.out_size);
+		});
+
+		out->Flush();
+	}
+
+	//Parity files open with a header page and records start at header_size, so every record sits at an aligned offset and record k is a jump away.
+	//The header names the profile, the digest of its symmetry and the data it covers, a parity file for other data, another symmetry or cut short
+	//is rejected from the header and the file length alone. Headerless files are the bare records of profile 0, as written before headers existed.
+	//
+
+	constexpr uint16_t parity_version = 2;
+	constexpr size_t parity_alignment = 4096;
+	constexpr uint64_t parity_unsized = ~uint64_t(0);
+
+	struct parity_header
+	{
+		char magic[4] = { 'D', '8', '8', 'P' };
+		uint16_t version = parity_version;
+		uint16_t profile = 0;
+		uint32_t header_size = parity_alignment;
+		uint32_t record_size = 0;
+		uint64_t size = 0;
+		uint64_t chunks = 0;
+		uint64_t padding = 0;
+		uint8_t digest[32] = {};
+	};
+
+	//magic, version, profile and header_size are where every version keeps them, a later version only appends fields inside the header page:
+	//
+
+	static_assert(offsetof(parity_header, version) == 4 && offsetof(parity_header, profile) == 6 && offsetof(parity_header, header_size) == 8);
+	static_assert(sizeof(parity_header) <= parity_alignment);
+
+	inline std::array<uint8_t, 32> profile_digest(size_t profile)
+	{
+		return with_profile(profile, [](auto p) { return decltype(p)::Digest(); });
+	}
+
+	//size is the data length, parity_unsized when a stream protects input of unknown length:
+	//
+
+	inline parity_header make_parity_header(size_t profile, uint64_t size)
+	{
+		auto p = describe_profile(profile);
+		auto digest = profile_digest(profile);
+
+		parity_header h;
+		h.profile = (uint16_t)profile;
+		h.record_size = (uint32_t)p.parity;
+		h.size = size;
+
+		if (size != parity_unsized)
+		{
+			h.chunks = (size + p.chunk - 1) / p.chunk;
+			h.padding = h.chunks * p.chunk - size;
+		}
+
+		std::copy(digest.begin(), digest.end(), h.digest);
+
+		return h;
+	}
+
+	//(profile, offset of the first record) of a parity file:
+	//
+
+	inline std::pair<size_t, size_t> parity_layout(gsl::span<const uint8_t> check)
+	{
+		parity_header h, expected;
+
+		if (check.size() < sizeof(h.magic) || !std::equal(expected.magic, expected.magic + 4, (const char*)check.data()))
+			return { 0, 0 };
+
+		if (check.size() < sizeof(h))
+			throw "Unsupported parity file.";
+
+		std::memcpy(&h, check.data(), sizeof(h));
+
+		if (h.version != parity_version || h.profile >= profile_count || h.header_size < sizeof(h) || h.header_size % parity_alignment)
+			throw "Unsupported parity file.";
+
+		auto digest = profile_digest(h.profile);
+
+		if (h.record_size != describe_profile(h.profile).parity || !std::equal(digest.begin(), digest.end(), h.digest))
+			throw "Parity file was written with a different symmetry.";
+
+		return { h.profile, h.header_size };
+	}
+
+	//The same, also checked against size bytes of data:
+	//
+
+	inline std::pair<size_t, size_t> parity_layout(gsl::span<const uint8_t> check, size_t size)
+	{
+		auto layout = parity_layout(check);
+		auto p = describe_profile(layout.first);
+
+		if (layout.second)
+		{
+			parity_header h;
+			std::memcpy(&h, check.data(), sizeof(h));
+
+			if (h.size != parity_unsized && (h.size != size || h.chunks != (size + p.chunk - 1) / p.chunk))
+				throw "Parity file belongs to different data.";
+		}
+
+		if (check.size() < layout.second || check.size() - layout.second != (size + p.chunk - 1) / p.chunk * p.parity)
+			throw "Parity file size does not match its data.";
+
+		return layout;
+	}
+
+	//Read only map of a parity file, checked against the size of the data it protects before anything else is read.
+	//
+
+	class parity_file
+	{
+	public:
+		parity_file(std::string_view path, size_t size) : map(path)
+		{
+			std::tie(profile, offset) = parity_layout(gsl::span<const uint8_t>((const uint8_t*)map.data(), map.size()), size);
+
+			record = describe_profile(profile).parity;
+		}
+
+		size_t Profile() const { return profile; }
+
+		gsl::span<const uint8_t> Records() const { return gsl::span<const uint8_t>((const uint8_t*)map.data() + offset, map.size() - offset); }
+
+		gsl::span<const uint8_t> Record(size_t k) const { return Records().subspan(k * record, record); }
+
+		void Sequential()
+		{
+#if defined(__linux__)
+			madvise((void*)map.data(), map.size(), MADV_SEQUENTIAL);
+#endif
+		}
+
+	private:
+		mio::mmap_source map;
+
+		size_t profile = 0, offset = 0, record = 0;
+	};
+
+	//Same parity file as default_protect, built from a sequential read of the input.
+	//
+
+	template <typename P> void stream_protect(std::string_view name, std::string_view output, const options_t& options)
+	{
+		using T = typename P::T;
+
+		auto& ectx = P::Context();
+
+		auto in = OpenStream(name, false, options), out = OpenStream(output, true, options);
+
+		size_t chunks = stream_chunks(P::chunk, options), batch = chunks * P::chunk;
+
+		std::vector<stream_slot_t> ring(stream_depth);
+
+		for (auto& slot : ring)
+		{
+			slot.in.resize(batch);
+			slot.out.resize(chunks * P::parity);
+		}
+
+		//A named file is sized up front and has to stay that size, a pipe gets an unsized header:
+		//
+
+		uint64_t size = (name != "-" && std::filesystem::is_regular_file(name)) ? std::filesystem::file_size(name) : parity_unsized, read = 0;
+
+		std::vector<uint8_t> page(parity_alignment, 0);
+		auto header = make_parity_header(options.profile, size);
+
+		std::memcpy(page.data(), &header, sizeof(header));
+		out->Write(page.data(), page.size());
+
+		StreamPipeline(ring, [&](stream_slot_t& slot)
+		{
+			slot.size = in->Read(slot.in.data(), batch);
+			read += slot.size;
+
+			if (size != parity_unsized && (read > size || (slot.size < batch && read != size)))
+				throw "Input changed size while it was protected.";
+
+			return slot.size == batch;
+		},
+		[&](stream_slot_t& slot)
+		{
+			auto source = gsl::span<const uint8_t>(slot.in.data(), slot.size);
+			size_t count = (slot.size + P::chunk - 1) / P::chunk;
+
+			ParallelFor(count, options, [&](size_t, size_t first, size_t last)
+			{
+				ScratchFrame scratch;
+				auto temp = scratch.Take<T>(P::blocks), tmp = scratch.Take<T>(P::blocks), ex = scratch.Take<T>(P::rec + P::val);
+
+				for (size_t i = first; i < last; i++)
+				{
+					for (size_t s = 0; s < P::stripes; s++)
+					{
+						d88::correct::immutable_extend_short<T, P::blocks, P::rec, P::val>(load_stripe<P>(source, i, s, tmp), temp, ex, ectx);
+						store_parity<P>(slot.out, i, s, ex);
+					}
+				}
+			});
+
+			slot.out_size = count * P::parity;
+		},
+		[&](stream_slot_t& slot)
+		{
+			out->Write(slot.out.data(), slot.out_size);
+		});
+
+		out->Flush();
+	}
+
+	void stream_protect(std::string_view name, std::string_view output, const options_t& options = options_t())
+	{
+		with_profile(options.profile, [&](auto p) { stream_protect<decltype(p)>(name, output, options); });
+	}
+
+	//Buffer forms of every operation, the caller owns both sides and sizes the output with encrypted_size, decrypted_size and protected_size.
+	//Nothing touches the filesystem. Only the padded tail chunk, parity words and any side that is not word aligned are copied.
+	//
+
+	inline size_t encrypted_size(size_t size)
+	{
+		constexpr size_t chunk = 1024;
+
+		size_t rem = size % chunk;
+
+		return (rem) ? size - rem + chunk + sizeof(uint64_t) : size;
+	}
+
+	inline size_t decrypted_size(gsl::span<const uint8_t> cipher)
+	{
+		constexpr size_t chunk = 1024;
+
+		size_t rem = cipher.size() % chunk;
+
+		if (!rem)
+			return cipher.size();
+
+		if (rem != sizeof(uint64_t) || cipher.size() < chunk + sizeof(uint64_t))
+			throw "Invalid encrypted size.";
+
+		uint64_t size;
+		std::memcpy(&size, cipher.data() + cipher.size() - sizeof(uint64_t), sizeof(size));
+
+		if (encrypted_size(size) != cipher.size() || !(size % chunk))
+			throw "Invalid encrypted size.";
+
+		return size;
+	}
+
+	inline size_t protected_size(size_t size, size_t profile = 0)
+	{
+		auto p = describe_profile(profile);
+
+		return (size + p.chunk - 1) / p.chunk * p.parity;
+	}
+
+	void encrypt_buffer(gsl::span<const uint8_t> source, gsl::span<uint8_t> dest, std::string_view k, const options_t& options = options_t())
+	{
+		constexpr unsigned blocks = 128;
+		constexpr unsigned chunk = 1024;
+		using T = uint64_t;
+
+		if (dest.size() != encrypted_size(source.size()))
+			throw "Output buffer size mismatch.";
+
+		auto context = default_context_cache().Get<d88::security::EncryptContextLong<T, blocks>, T, blocks>(k);
+		auto& ec = *context;
+		auto tweak = chunk_tweak(k, options);
+
+		size_t rem = source.size() % chunk;
+		size_t chunks = source.size() / chunk;
+
+		auto& pool = SharedPool(options);
+
+		pool.For(chunks, multi_grain<T>(chunks, pool.size(), options.grain), [&](size_t, size_t first, size_t last)
+		{
+			auto n = last - first;
+
+			staged_chunks<T, blocks>(source.data() + first * chunk, dest.data() + first * chunk, n, [&](auto in, auto out, size_t c)
+			{
+				encrypt_chunks<T, blocks>(in, out, ec, tweak.get(), first + c);
+			});
+		});
+
+		//Padding:
+		//
+
+		if (rem)
+		{
+			std::vector<uint8_t> tmp = d8u::random::Vector<uint8_t>(chunk);
+
+			std::copy(source.end() - rem, source.end(), tmp.begin());
+
+			staged_chunks<T, blocks>(tmp.data(), dest.data() + chunks * chunk, 1, [&](auto in, auto out, size_t)
+			{
+				encrypt_chunks<T, blocks>(in, out, ec, tweak.get(), chunks);
+			});
+
+			uint64_t size = source.size();
+			std::memcpy(dest.data() + dest.size() - sizeof(uint64_t), &size, sizeof(size));
+		}
+	}
+
+	void decrypt_buffer(gsl::span<const uint8_t> source, gsl::span<uint8_t> dest, std::string_view k, const options_t& options = options_t())
+	{
+		constexpr unsigned blocks = 128;
+		constexpr unsigned chunk = 1024;
+		using T = uint64_t;
+
+		if (dest.size() != decrypted_size(source))
+			throw "Output buffer size mismatch.";
+
+		auto context = default_context_cache().Get<d88::security::DecryptContextShort<T, blocks>, T, blocks>(k);
+		auto& dc = *context;
+		auto tweak = chunk_tweak(k, options);
+
+		size_t rem = dest.size() % chunk;
+		size_t chunks = dest.size() / chunk;
+
+		auto& pool = SharedPool(options);
+
+		pool.For(chunks, multi_grain<T>(chunks, pool.size(), options.grain), [&](size_t, size_t first, size_t last)
+		{
+			auto n = last - first;
+
+			staged_chunks<T, blocks>(source.data() + first * chunk, dest.data() + first * chunk, n, [&](auto in, auto out, size_t c)
+			{
+				decrypt_chunks<T, blocks>(in, out, dc, tweak.get(), first + c);
+			});
+		});
+
+		//Padding:
+		//
+
+		if (rem)
+		{
+			ScratchFrame scratch;
+			auto tmp = scratch.Take<uint8_t>(chunk);
+
+			staged_chunks<T, blocks>(source.data() + chunks * chunk, tmp.data(), 1, [&](auto in, auto out, size_t)
+			{
+				decrypt_chunks<T, blocks>(in, out, dc, tweak.get(), chunks);
+			});
+
+			std::copy(tmp.begin(), tmp.begin() + rem, dest.end() - rem);
+		}
+	}
+
+	//Random access over the default_encrypt format. Chunks are encrypted independently at a fixed stride, so chunk k of the plain text is
+	//the cipher at k * chunk and only the trailer is needed to know the length. Read decrypts just the chunks a range touches:
+	//whole chunks go straight into the destination across the pool, through staged_chunks when either side is not word aligned,
+	//the partial chunks at either end come from a small LRU of decrypted chunks. Concurrent reads share the reader, only the LRU takes its lock.
+	//
+
+	class decrypt_reader
+	{
+	public:
+		using T = uint64_t;
+
+		static constexpr size_t blocks = 128;
+		static constexpr size_t chunk = 1024;
+
+		struct stats_t
+		{
+			size_t hits = 0;
+			size_t misses = 0;
+		};
+
+		decrypt_reader(std::string_view path, std::string_view k, size_t cache = 64, const options_t& options = options_t()) : map(std::string(path)), options(options)
+		{
+			Open(gsl::span<const uint8_t>((const uint8_t*)map.data(), map.size()), k, cache);
+		}
+
+		decrypt_reader(const char* path, std::string_view k, size_t cache = 64, const options_t& options = options_t()) : decrypt_reader(std::string_view(path), k, cache, options) {}
+
+		decrypt_reader(gsl::span<const uint8_t> cipher, std::string_view k, size_t cache = 64, const options_t& options = options_t()) : options(options)
+		{
+			Open(cipher, k, cache);
+		}
+
+		decrypt_reader(const decrypt_reader&) = delete;
+		decrypt_reader& operator=(const decrypt_reader&) = delete;
+
+		size_t size() const { return length; }
+
+		//Fills dest from offset, short only at the end of the plain text:
+		//
+
+		size_t Read(size_t offset, gsl::span<uint8_t> dest)
+		{
+			if (offset >= length)
+				return 0;
+
+			size_t n = std::min(dest.size(), length - offset), end = offset + n;
+
+			//Whole chunks, the padded tail is never one:
+			//
+
+			size_t first = (offset + chunk - 1) / chunk, last = std::min(end / chunk, length / chunk);
+
+			if (first < last)
+			{
+				uint8_t* out = dest.data() + first * chunk - offset;
+
+				auto& pool = SharedPool(options);
+
+				pool.For(last - first, multi_grain<T>(last - first, pool.size(), options.grain), [&](size_t, size_t a, size_t b)
+				{
+					staged_chunks<T, blocks>(cipher.data() + (first + a) * chunk, out + a * chunk, b - a, [&](auto in, auto plain, size_t c)
+					{
+						decrypt_chunks<T, blocks>(in, plain, *context, tweak.get(), first + a + c);
+					});
+				});
+			}
+
+			for (size_t at = offset; at < end;)
+			{
+				if (first < last && at == first * chunk)
+				{
+					at = last * chunk;
+					continue;
+				}
+
+				size_t skip = at % chunk, take = std::min(chunk - skip, end - at);
+
+				Copy(at / chunk, skip, take, dest.data() + (at - offset));
+
+				at += take;
+			}
+
+			return n;
+		}
+
+		std::vector<uint8_t> Read(size_t offset, size_t n)
+		{
+			std::vector<uint8_t> result((offset < length) ? std::min(n, length - offset) : 0);
+
+			Read(offset, result);
+
+			return result;
+		}
+
+		stats_t Stats()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return stats;
+		}
+
+	private:
+		struct slot_t
+		{
+			size_t at;
+			std::vector<T> data;
+		};
+
+		void Open(gsl::span<const uint8_t> _cipher, std::string_view k, size_t cache)
+		{
+			cipher = _cipher;
+			length = decrypted_size(cipher);
+			context = default_context_cache().Get<d88::security::DecryptContextShort<T, blocks>, T, blocks>(k);
+			tweak = chunk_tweak(k, options);
+
+			for (size_t i = 0; i < ((cache) ? cache : 1); i++)
+				lru.push_back({ ~size_t(0), std::vector<T>(blocks) });
+		}
+
+		//Copies take bytes from skip of decrypted chunk k. A miss is decrypted outside the lock and then replaces the least recently used slot:
+		//
+
+		void Copy(size_t k, size_t skip, size_t take, uint8_t* out)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m);
+
+				auto it = index.find(k);
+
+				if (it != index.end())
+				{
+					lru.splice(lru.begin(), lru, it->second);
+					stats.hits++;
+
+					const uint8_t* plain = (const uint8_t*)lru.front().data.data();
+					std::copy(plain + skip, plain + skip + take, out);
+
+					return;
+				}
+			}
+
+			ScratchFrame scratch;
+			auto plain = scratch.Take<T>(blocks);
+
+			staged_chunks<T, blocks>(cipher.data() + k * chunk, (uint8_t*)plain.data(), 1, [&](auto in, auto out, size_t)
+			{
+				decrypt_chunks<T, blocks>(in, out, *context, tweak.get(), k);
+			});
+
+			std::copy((const uint8_t*)plain.data() + skip, (const uint8_t*)plain.data() + skip + take, out);
+
+			std::lock_guard<std::mutex> lock(m);
+
+			stats.misses++;
+
+			if (index.count(k))
+				return;
+
+			lru.splice(lru.begin(), lru, std::prev(lru.end()));
+			index.erase(lru.front().at);
+
+			std::copy(plain.begin(), plain.end(), lru.front().data.begin());
+
+			lru.front().at = k;
+			index[k] = lru.begin();
+		}
+
+		mio::mmap_source map;
+		gsl::span<const uint8_t> cipher;
+		size_t length = 0;
+
+		options_t options;
+		std::shared_ptr<const d88::security::DecryptContextShort<T, blocks>> context;
+		std::unique_ptr<d88::security::TweakKey> tweak;
+
+		std::mutex m;
+		stats_t stats;
+
+		std::list<slot_t> lru;
+		std::unordered_map<size_t, std::list<slot_t>::iterator> index;
+	};
+
+	//Decrypts length bytes from offset of an encrypted file into o, "-" for stdout, through a stream_buffer sized window.
+	//
+
+	void range_decrypt(std::string_view i, std::string_view o, std::string_view k, size_t offset, size_t length, const options_t& options = options_t())
+	{
+		decrypt_reader reader(i, k, 64, options);
+
+		auto out = OpenStream(o, true, options_t());
+		std::vector<uint8_t> window((options.buffer) ? options.buffer : stream_buffer);
+
+		while (length)
+		{
+			size_t got = reader.Read(offset, gsl::span<uint8_t>(window.data(), std::min(length, window.size())));
+
+			if (!got)
+				break;
+
+			out->Write(window.data(), got);
+
+			offset += got;
+			length -= got;
+		}
+
+		out->Flush();
+	}
+
+	//Protect, verify, repair and re-protect are compiled per profile as protect_buffer<P> and so on, the plain forms run the entry options.profile names.
+	//
+
+	template <typename P> void protect_buffer(gsl::span<const uint8_t> source, gsl::span<uint8_t> parity, const options_t& options)
+	{
+		using T = typename P::T;
+
+		if (parity.size() != P::Chunks(source.size()) * P::parity)
+			throw "Parity buffer size mismatch.";
+
+		auto& ectx = P::Context();
+
+		ParallelFor(P::Chunks(source.size()), options, [&](size_t, size_t first, size_t last)
+		{
+			ScratchFrame scratch;
+			auto temp = scratch.Take<T>(P::blocks), tmp = scratch.Take<T>(P::blocks), ex = scratch.Take<T>(P::rec + P::val);
+
+			for (size_t i = first; i < last; i++)
+			{
+				for (size_t s = 0; s < P::stripes; s++)
+				{
+					d88::correct::immutable_extend_short<T, P::blocks, P::rec, P::val>(load_stripe<P>(source, i, s, tmp), temp, ex, ectx);
+					store_parity<P>(parity, i, s, ex);
+				}
+			}
+		});
+	}
+
+	void protect_buffer(gsl::span<const uint8_t> source, gsl::span<uint8_t> parity, const options_t& options = options_t())
+	{
+		with_profile(options.profile, [&](auto p) { protect_buffer<decltype(p)>(source, parity, options); });
+	}
+
+	//Checks every chunk against its parity without repairing, false as soon as any chunk disagrees.
+	//
+
+	template <typename P> bool verify_buffer(gsl::span<const uint8_t> source, gsl::span<const uint8_t> parity, const options_t& options)
+	{
+		using T = typename P::T;
+
+		if (parity.size() != P::Chunks(source.size()) * P::parity)
+			throw "Parity buffer size mismatch.";
+
+		auto& ectx = P::Context();
+
+		std::atomic<bool> valid = true;
+
+		ParallelFor(P::Chunks(source.size()), options, [&](size_t, size_t first, size_t last)
+		{
+			ScratchFrame scratch;
+			auto temp = scratch.Take<T>(P::blocks), tmp = scratch.Take<T>(P::blocks), ex_temp = scratch.Take<T>(P::rec + P::val), ex = scratch.Take<T>(P::rec + P::val);
+
+			for (size_t i = first; i < last && valid; i++)
+				for (size_t s = 0; s < P::stripes && valid; s++)
+					if (!d88::correct::validate_immutable_short<T, P::blocks, P::rec, P::val>(load_stripe<P>(source, i, s, tmp), temp, load_parity<P>(parity, i, s, ex), ex_temp, ectx))
+						valid = false;
+		});
+
+		return valid;
+	}
+
+	bool verify_buffer(gsl::span<const uint8_t> source, gsl::span<const uint8_t> parity, const options_t& options = options_t())
+	{
+		return with_profile(options.profile, [&](auto p) { return verify_buffer<decltype(p)>(source, parity, options); });
+	}
+
+	//One bit per chunk, set where the chunk disagrees with its parity.
+	//
+
+	struct chunk_bitmap
+	{
+		size_t chunks = 0;
+		std::vector<uint64_t> bits;
+		size_t chunk = 0;
+
+		bool Test(size_t i) const { return (bits[i / 64] >> (i % 64)) & 1; }
+
+		size_t Count() const
+		{
+			size_t n = 0;
+
+			for (auto w : bits)
+				n += std::popcount(w);
+
+			return n;
+		}
+
+		//Runs of consecutive bad chunks as (first, count):
+		//
+
+		std::vector<std::pair<size_t, size_t>> Runs() const
+		{
+			std::vector<std::pair<size_t, size_t>> runs;
+
+			for (size_t i = 0; i < chunks; i++)
+			{
+				if (!Test(i))
+					continue;
+
+				if (runs.size() && runs.back().first + runs.back().second == i)
+					runs.back().second++;
+				else
+					runs.emplace_back(i, 1);
+			}
+
+			return runs;
+		}
+	};
+
+	inline size_t chunk_words(size_t size, size_t profile = 0)
+	{
+		size_t chunk = describe_profile(profile).chunk;
+
+		return ((size + chunk - 1) / chunk + 63) / 64;
+	}
+
+	//Read-only sweep of every chunk into bits, chunk_words long. Never stops early and never writes to source or parity.
+	//Each task owns whole 64 chunk words of the bitmap so workers never share one.
+	//
+
+	template <typename P> void verify_chunks(gsl::span<const uint8_t> source, gsl::span<const uint8_t> parity, gsl::span<uint64_t> bits, const options_t& options)
+	{
+		using T = typename P::T;
+
+		size_t chunks = P::Chunks(source.size());
+
+		if (parity.size() != chunks * P::parity)
+			throw "Parity buffer size mismatch.";
+
+		if (bits.size() != (chunks + 63) / 64)
+			throw "Bitmap size mismatch.";
+
+		auto& ectx = P::Context();
+
+		std::fill(bits.begin(), bits.end(), 0);
+
+		options_t words = options;
+		words.grain = (options.grain + 63) / 64;
+
+		ParallelFor(bits.size(), words, [&](size_t, size_t first, size_t last)
+		{
+			ScratchFrame scratch;
+			auto temp = scratch.Take<T>(P::blocks), ex_temp = scratch.Take<T>(P::rec + P::val), tmp = scratch.Take<T>(P::blocks), ex = scratch.Take<T>(P::rec + P::val);
+
+			for (size_t i = first * 64; i < std::min(last * 64, chunks); i++)
+			{
+				for (size_t s = 0; s < P::stripes; s++)
+				{
+					if (!d88::correct::validate_immutable_short<T, P::blocks, P::rec, P::val>(load_stripe<P>(source, i, s, tmp), temp, load_parity<P>(parity, i, s, ex), ex_temp, ectx))
+					{
+						bits[i / 64] |= uint64_t(1) << (i % 64);
+						break;
+					}
+				}
+			}
+		});
+	}
+
+	void verify_chunks(gsl::span<const uint8_t> source, gsl::span<const uint8_t> parity, gsl::span<uint64_t> bits, const options_t& options = options_t())
+	{
+		with_profile(options.profile, [&](auto p) { verify_chunks<decltype(p)>(source, parity, bits, options); });
+	}
+
+	chunk_bitmap verify_chunks(gsl::span<const uint8_t> source, gsl::span<const uint8_t> parity, const options_t& options = options_t())
+	{
+		chunk_bitmap result;
+		result.chunk = describe_profile(options.profile).chunk;
+		result.chunks = (source.size() + result.chunk - 1) / result.chunk;
+		result.bits.resize(chunk_words(source.size(), options.profile));
+
+		verify_chunks(source, parity, result.bits, options);
+
+		return result;
+	}
+
+	//Spreads the window search of one damaged chunk over the pool. Every worker skips windows past the lowest one that has validated,
+	//so the winner is the same window the serial search would pick.
+	//
+
+	template <typename T, size_t S, size_t E, size_t C> bool repair_spread(gsl::span<T> blk, gsl::span<T> ex, d88::correct::RepairPlan<T, S, E, C>& plan, d88::correct::ImmutableShortContext<T, S, E>& ectx, const options_t& options)
+	{
+		constexpr size_t windows = S - E;
+
+		ScratchFrame scratch;
+		auto dots = scratch.Take<T>(E + C), temp1 = scratch.Take<T>(S), temp2 = scratch.Take<T>(S), ex_temp = scratch.Take<T>(E + C);
+
+		d88::correct::repair_dots<T, S, E, C>(blk, dots, plan);
+
+		std::atomic<size_t> best = windows;
+
+		options_t spread = options;
+		spread.grain = 0;
+
+		ParallelFor(windows, spread, [&](size_t, size_t first, size_t last)
+		{
+			ScratchFrame scratch;
+			auto temp1 = scratch.Take<T>(S), temp2 = scratch.Take<T>(S), ex_temp = scratch.Take<T>(E + C);
+
+			for (size_t i = first; i < last && i < best; i++)
+			{
+				if (d88::correct::repair_window<T, S, E, C>(i, blk, temp1, temp2, ex, ex_temp, dots.data(), plan, ectx))
+				{
+					size_t current = best;
+					while (i < current && !best.compare_exchange_weak(current, i));
+
+					break;
+				}
+			}
+		});
+
+		if (best == windows)
+			return false;
+
+		d88::correct::repair_window<T, S, E, C>(best, blk, temp1, temp2, ex, ex_temp, dots.data(), plan, ectx);
+		std::copy(temp1.begin(), temp1.end(), blk.begin());
+
+		return true;
+	}
+
+	//Repairs the chunks set in bits, as a verify sweep leaves them, and clears each one it recovers. Returns how many stay unrecoverable.
+	//With fewer bad chunks than workers a chunk at a time gets the whole pool, otherwise whole chunks are shared out.
+	//Only the stripes of an interleaved chunk that fail validation are repaired, the chunk is recovered once all of them are.
+	//
+
+	template <typename P> size_t repair_chunks(gsl::span<uint8_t> source, gsl::span<const uint8_t> parity, gsl::span<uint64_t> bits, const options_t& options)
+	{
+		using T = typename P::T;
+		constexpr size_t blocks = P::blocks, rec = P::rec, val = P::val;
+
+		if (parity.size() != P::Chunks(source.size()) * P::parity)
+			throw "Parity buffer size mismatch.";
+
+		if (bits.size() != (P::Chunks(source.size()) + 63) / 64)
+			throw "Bitmap size mismatch.";
+
+		size_t count = 0;
+
+		for (auto w : bits)
+			count += std::popcount(w);
+
+		if (!count)
+			return 0;
+
+		ScratchFrame frame;
+		auto list = frame.Take<size_t>(count);
+		auto ok = frame.Zero<uint8_t>(count);
+
+		for (size_t i = 0, k = 0; k < count; i++)
+			if ((bits[i / 64] >> (i % 64)) & 1)
+				list[k++] = i;
+
+		auto& ectx = P::Context();
+		auto& plan = P::Plan();
+
+		bool skewed = count < SharedPool(options).size();
+
+		auto repair = [&](size_t i)
+		{
+			ScratchFrame scratch;
+			auto tmp = scratch.Take<T>(blocks), temp = scratch.Take<T>(blocks), temp2 = scratch.Take<T>(blocks), ex_temp = scratch.Take<T>(rec + val), words = scratch.Take<T>(rec + val);
+
+			bool all = true;
+
+			for (size_t s = 0; s < P::stripes; s++)
+			{
+				auto blk = load_stripe<P>(source, i, s, tmp);
+				auto ex = load_parity<P>(parity, i, s, words);
+
+				if (P::stripes > 1 && d88::correct::validate_immutable_short<T, blocks, rec, val>(blk, temp, ex, ex_temp, ectx))
+					continue;
+
+				bool repaired;
+
+				if (skewed)
+				{
+					repaired = d88::correct::repair_scattered<T, blocks, rec, val>(1, blk, temp, temp2, ex, ex_temp, plan, ectx)
+						|| repair_spread<T, blocks, rec, val>(blk, ex, plan, ectx, options)
+						|| d88::correct::repair_scattered<T, blocks, rec, val>(2, blk, temp, temp2, ex, ex_temp, plan, ectx);
+				}
+				else
+					repaired = d88::correct::repair_locate<T, blocks, rec, val>(blk, temp, temp2, ex, ex_temp, plan, ectx);
+
+				if (repaired)
+					store_stripe<P>(source, i, s, blk);
+
+				all = all && repaired;
+			}
+
+			return all;
+		};
+
+		if (skewed)
+		{
+			for (size_t k = 0; k < count; k++)
+				ok[k] = repair(list[k]);
+		}
+		else
+		{
+			ParallelFor(count, options, [&](size_t, size_t first, size_t last)
+			{
+				for (size_t k = first; k < last; k++)
+					ok[k] = repair(list[k]);
+			});
+		}
+
+		size_t failed = count;
+
+		for (size_t k = 0; k < count; k++)
+		{
+			if (ok[k])
+			{
+				bits[list[k] / 64] &= ~(uint64_t(1) << (list[k] % 64));
+				failed--;
+			}
+		}
+
+		return failed;
+	}
+
+	size_t repair_chunks(gsl::span<uint8_t> source, gsl::span<const uint8_t> parity, gsl::span<uint64_t> bits, const options_t& options = options_t())
+	{
+		return with_profile(options.profile, [&](auto p) { return repair_chunks<decltype(p)>(source, parity, bits, options); });
+	}
+
+	//Repairs source in place, false if any chunk was beyond repair.
+	//
+
+	bool recover_buffer(gsl::span<uint8_t> source, gsl::span<const uint8_t> parity, const options_t& options = options_t())
+	{
+		ScratchFrame scratch;
+		auto bits = scratch.Take<uint64_t>(chunk_words(source.size(), options.profile));
+
+		verify_chunks(source, parity, bits, options);
+
+		return repair_chunks(source, parity, bits, options) == 0;
+	}
+
+	//Re-protect patches only the parity of chunks whose content changed, so untouched parity pages are never written.
+	//Each stripe looked at is dotted with all rec + val rows of the repair plan, which are its parity words, and written back only where they differ.
+	//Without a range list every chunk is looked at, with (offset, length) byte ranges only the chunks they touch are.
+	//Both return the number of chunks patched.
+	//
+
+	using byte_ranges = std::vector<std::pair<size_t, size_t>>;
+
+	//A range list file holds whitespace separated offset length pairs, as a nightly job's change log would write them:
+	//
+
+	inline byte_ranges load_byte_ranges(std::string_view path)
+	{
+		std::ifstream in{ std::string(path) };
+
+		if (!in)
+			throw "Unable to open range list.";
+
+		byte_ranges ranges;
+		size_t offset, length;
+
+		while (in >> offset >> length)
+			ranges.emplace_back(offset, length);
+
+		if (!in.eof())
+			throw "Invalid range list.";
+
+		return ranges;
+	}
+
+	template <typename P, typename L> size_t reprotect_chunks(gsl::span<const uint8_t> source, gsl::span<uint8_t> parity, size_t count, L chunk_at, const options_t& options)
+	{
+		using T = typename P::T;
+
+		if (parity.size() != P::Chunks(source.size()) * P::parity)
+			throw "Parity buffer size mismatch.";
+
+		auto& plan = P::Plan();
+
+		std::atomic<size_t> patched = 0;
+
+		ParallelFor(count, options, [&](size_t, size_t first, size_t last)
+		{
+			ScratchFrame scratch;
+			auto ex_temp = scratch.Take<T>(P::rec + P::val), tmp = scratch.Take<T>(P::blocks), words = scratch.Take<T>(P::rec + P::val);
+
+			for (size_t k = first; k < last; k++)
+			{
+				size_t i = chunk_at(k);
+				bool changed = false;
+
+				for (size_t s = 0; s < P::stripes; s++)
+				{
+					auto ex = load_parity<P>(parity, i, s, words);
+					auto stripe = load_stripe<P>(source, i, s, tmp);
+
+					for (size_t v = 0; v < P::rec + P::val; v++)
+						ex_temp[v] = d88::simd::Dot<T>(stripe.data(), plan.Row(v), P::blocks);
+
+					if (!std::equal(ex_temp.begin(), ex_temp.end(), ex.begin()))
+					{
+						store_parity<P>(parity, i, s, ex_temp);
+						changed = true;
+					}
+				}
+
+				if (changed)
+					patched++;
+			}
+		});
+
+		return patched;
+	}
+
+	size_t reprotect_buffer(gsl::span<const uint8_t> source, gsl::span<uint8_t> parity, const options_t& options = options_t())
+	{
+		return with_profile(options.profile, [&](auto p)
+		{
+			using P = decltype(p);
+
+			return reprotect_chunks<P>(source, parity, P::Chunks(source.size()), [](size_t k) { return k; }, options);
+		});
+	}
+
+	size_t reprotect_buffer(gsl::span<const uint8_t> source, gsl::span<uint8_t> parity, const byte_ranges& ranges, const options_t& options = options_t())
+	{
+		size_t chunk = describe_profile(options.profile).chunk;
+
+		size_t chunks = (source.size() + chunk - 1) / chunk;
+		std::vector<size_t> stale;
+
+		for (auto& r : ranges)
+		{
+			if (!r.second || r.first >= source.size())
+				continue;
+
+			size_t last = std::min(r.first + r.second, source.size());
+
+			for (size_t i = r.first / chunk; i < chunks && i * chunk < last; i++)
+				stale.push_back(i);
+		}
+
+		std::sort(stale.begin(), stale.end());
+		stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+
+		return with_profile(options.profile, [&](auto p) { return reprotect_chunks<decltype(p)>(source, parity, stale.size(), [&](size_t k) { return stale[k]; }, options); });
+	}
+
+	void default_encrypt(std::string_view i, std::string_view o, std::string_view k, const options_t& options = options_t())
+	{
+		if (options.direct)
+			return stream_encrypt(i, o, k, options);
+
+		mio::mmap_source file(i);
+
+		allocate_file(o, encrypted_size(file.size()));
+		mio::mmap_sink result(o);
+
+		encrypt_buffer(gsl::span<const uint8_t>((const uint8_t*)file.data(), file.size()), gsl::span<uint8_t>((uint8_t*)result.data(), result.size()), k, options);
+	}
+
+	void default_decrypt(std::string_view i, std::string_view o, std::string_view k, const options_t& options = options_t())
+	{
+		if (options.direct)
+			return stream_decrypt(i, o, k, options);
+
+		mio::mmap_source file(i);
+		gsl::span<const uint8_t> source((const uint8_t*)file.data(), file.size());
+
+		allocate_file(o, decrypted_size(source));
+		mio::mmap_sink result(o);
+
+		decrypt_buffer(source, gsl::span<uint8_t>((uint8_t*)result.data(), result.size()), k, options);
+	}
+
+	void default_protect(std::string_view name,std::string_view output, const options_t& options = options_t())
+	{
+		if (options.direct)
+			return stream_protect(name, output, options);
+
+		mio::mmap_source file(name);
+
+		auto header = make_parity_header(options.profile, file.size());
+
+		allocate_file(output, header.header_size + protected_size(file.size(), options.profile));
+		mio::mmap_sink result(output);
+
+		std::memcpy(result.data(), &header, sizeof(header));
+
+		protect_buffer(gsl::span<const uint8_t>((const uint8_t*)file.data(), file.size()), gsl::span<uint8_t>((uint8_t*)result.data() + header.header_size, result.size() - header.header_size), options);
+	}
+
+	//Brings an existing recovery context up to date with name, resizing it if the file grew or shrank. A missing context is protected from scratch.
+	//An existing context keeps the profile and layout it was written with, a header is restamped with the new size.
+	//
+
+	size_t default_reprotect(std::string_view name, std::string_view output, const byte_ranges& ranges, bool scan, const options_t& options = options_t())
+	{
+		if (!std::filesystem::exists(output))
+		{
+			size_t chunk = describe_profile(options.profile).chunk;
+
+			default_protect(name, output, options);
+			return (std::filesystem::file_size(name) + chunk - 1) / chunk;
+		}
+
+		mio::mmap_source file(name);
+
+		options_t layout = options;
+		size_t offset;
+
+		{
+			mio::mmap_source existing(output);
+			std::tie(layout.profile, offset) = parity_layout(gsl::span<const uint8_t>((const uint8_t*)existing.data(), existing.size()));
+		}
+
+		auto profile = describe_profile(layout.profile);
+
+		size_t before = std::filesystem::file_size(output) - offset, after = protected_size(file.size(), layout.profile);
+		byte_ranges changed = ranges;
+
+		//Chunks past the old end, including an old partial tail, have no valid parity yet:
+		//
+
+		if (before != after)
+		{
+			size_t from = std::min(before, after) / profile.parity;
+			if (from) from--;
+
+			std::filesystem::resize_file(output, offset + after);
+			changed.emplace_back(from * profile.chunk, file.size() - std::min(file.size(), from * profile.chunk));
+		}
+
+		mio::mmap_sink result(output);
+
+		if (offset)
+		{
+			auto header = make_parity_header(layout.profile, file.size());
+			header.header_size = (uint32_t)offset;
+
+			std::memcpy(result.data(), &header, sizeof(header));
+		}
+
+		gsl::span<const uint8_t> source((const uint8_t*)file.data(), file.size());
+		gsl::span<uint8_t> check((uint8_t*)result.data() + offset, result.size() - offset);
+
+		return (scan) ? reprotect_buffer(source, check, layout) : reprotect_buffer(source, check, changed, layout);
+	}
+
+	size_t default_reprotect(std::string_view name, std::string_view output, const options_t& options = options_t())
+	{
+		return default_reprotect(name, output, byte_ranges(), true, options);
+	}
+
+	size_t default_reprotect(std::string_view name, std::string_view output, const byte_ranges& ranges, const options_t& options = options_t())
+	{
+		return default_reprotect(name, output, ranges, false, options);
+	}
+
+	//Maps both files read only, a sweep never dirties a page of either. A parity file that does not fit the data throws before the sweep.
+	//
+
+	chunk_bitmap default_verify(std::string_view name, std::string_view _check, const options_t& options = options_t())
+	{
+		mio::mmap_source file(name);
+		parity_file check(_check, file.size());
+
+#if defined(__linux__)
+		madvise((void*)file.data(), file.size(), MADV_SEQUENTIAL);
+#endif
+		check.Sequential();
+
+		options_t layout = options;
+		layout.profile = check.Profile();
+
+		return verify_chunks(gsl::span<const uint8_t>((const uint8_t*)file.data(), file.size()), check.Records(), layout);
+	}
+
+	void default_recover(std::string_view name, std::string_view _check, const options_t& options = options_t())
+	{
+		parity_file check(_check, std::filesystem::file_size(name));
+		mio::mmap_sink file(name);
+
+		gsl::span<uint8_t> source((uint8_t*)file.data(), file.size());
+		gsl::span<const uint8_t> parity = check.Records();
+
+		options_t layout = options;
+		layout.profile = check.Profile();
+
+		auto bad = verify_chunks(source, parity, layout), failed = bad;
+		size_t chunk = bad.chunk;
+
+		repair_chunks(source, parity, failed.bits, layout);
+
+		for (size_t k = 0; k < bad.chunks; k++)
+		{
+			if (!bad.Test(k))
+				continue;
+
+			std::cout << "Validation Failed for Chunk " << k << std::endl;
+
+			if (failed.Test(k))
+				std::cout << "Unrecoverable block " << k * chunk << " => " << k * chunk + chunk << std::endl;
+			else
+				std::cout << "Recovered Block!" << std::endl;
+		}
+	}
+
+	template <typename B> std::vector<uint8_t> protect_block(const B& block, const options_t& options = options_t())
+	{
+		std::vector<uint8_t> result(protected_size(block.size(), options.profile));
+
+		protect_buffer(gsl::span<const uint8_t>((const uint8_t*)block.data(), block.size()), result, options);
+
+		return result;
+	}
+
+	template <typename B, typename C> bool recover_block(const B& block, const C& check, const options_t& options = options_t())
+	{
+		return recover_buffer(gsl::span<uint8_t>((uint8_t*)block.data(), block.size()), gsl::span<const uint8_t>((const uint8_t*)check.data(), check.size()), options);
 	}
 }
\ No newline at end of file
@@ -5,17 +5,23 @@
 #include <vector>
 #include <tuple>
 #include <string>
+#include <array>
 
 #include <type_traits>
 #include <algorithm>
 #include <execution>
 
 #include <atomic>
+#include <new>
+#include <thread>
 
 #include "../gsl-lite.hpp"
 #include "../num.hpp"
 #include "../picosha2.hpp"
 
+#include "simd.hpp"
+#include "pool.hpp"
+
 namespace d88
 {
     using namespace std;
@@ -50,51 +56,259 @@ namespace d88
         return make_tuple(gcd, (y - (b / a) * x), x);
     }
 
-    template <typename T> class PascalTriangle
+    template <typename T, size_t A = 64> class aligned_allocator
     {
     public:
-        PascalTriangle(size_t height)
+        using value_type = T;
+
+        template <typename U> struct rebind { using other = aligned_allocator<U, A>; };
+
+        aligned_allocator() noexcept {}
+        template <typename U> aligned_allocator(const aligned_allocator<U, A>&) noexcept {}
+
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(A)));
+        }
+
+        void deallocate(T* p, size_t) noexcept
+        {
+            ::operator delete(p, std::align_val_t(A));
+        }
+
+        template <typename U> bool operator==(const aligned_allocator<U, A>&) const noexcept { return true; }
+        template <typename U> bool operator!=(const aligned_allocator<U, A>&) const noexcept { return false; }
+    };
+
+    template <typename T> using aligned_vector = vector<T, aligned_allocator<T>>;
+
+    //Bump allocator for per chunk temporaries, every take is 64 byte aligned and left uninitialized.
+    //Blocks are only ever added, so once a thread has seen its largest chunk it runs without touching the heap.
+    //
+
+    class ScratchArena
+    {
+    public:
+        static constexpr size_t alignment = 64;
+        static constexpr size_t minimum_block = 64 * 1024;
+
+        template <typename T> span<T> Take(size_t n)
         {
-            data.resize(height);
+            static_assert(is_trivially_copyable_v<T> && alignof(T) <= alignment, "scratch holds plain aligned values only");
+
+            size_t bytes = (n * sizeof(T) + alignment - 1) & ~(alignment - 1);
+
+            while (block < blocks.size() && used + bytes > blocks[block].size())
+            {
+                block++;
+                used = 0;
+            }
+
+            if (block == blocks.size())
+            {
+                size_t grow = (capacity > minimum_block) ? capacity : minimum_block;
+                blocks.emplace_back((bytes > grow) ? bytes : grow);
+                capacity += blocks.back().size();
+            }
+
+            T* p = reinterpret_cast<T*>(blocks[block].data() + used);
+            used += bytes;
+
+            return span<T>(p, n);
+        }
+
+        size_t Capacity() const { return capacity; }
+
+    private:
+        friend class ScratchFrame;
+
+        vector<aligned_vector<uint8_t>> blocks;
+        size_t block = 0, used = 0, capacity = 0;
+    };
+
+    //The calling thread's arena, pool workers are persistent so theirs stay warm between calls.
+    //
 
-            data[0].push_back(1);
+    inline ScratchArena& LocalScratch()
+    {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+
+    //Scoped view of LocalScratch(), everything taken through a frame is released when it closes so frames nest.
+    //
+
+    class ScratchFrame
+    {
+    public:
+        ScratchFrame() : arena(LocalScratch()), block(arena.block), used(arena.used) {}
+
+        ~ScratchFrame()
+        {
+            arena.block = block;
+            arena.used = used;
+        }
+
+        ScratchFrame(const ScratchFrame&) = delete;
+        ScratchFrame& operator=(const ScratchFrame&) = delete;
+
+        template <typename T> span<T> Take(size_t n) { return arena.Take<T>(n); }
+
+        template <typename T> span<T> Zero(size_t n)
+        {
+            auto s = arena.Take<T>(n);
+            fill(s.begin(), s.end(), T(0));
+            return s;
+        }
+
+    private:
+        ScratchArena& arena;
+        size_t block, used;
+    };
+
+    //Rows are packed back to back in one buffer, row i starts at i(i+1)/2 and holds i+1 terms.
+    //
+
+    constexpr size_t PascalOffset(size_t dx) { return dx * (dx + 1) / 2; }
+
+    //Largest triangle we let the compiler emit into read only data, 512 rows of uint64_t is ~1MB.
+    //
+
+    constexpr size_t static_pascal_limit = 512;
+
+    template <typename T, size_t S> constexpr array<T, PascalOffset(S)> GeneratePascalRows()
+    {
+        array<T, PascalOffset(S)> rows{};
+
+        rows[0] = 1;
+
+        for (size_t i = 1; i < S; i++)
+        {
+            size_t prev = PascalOffset(i - 1), row = PascalOffset(i);
+
+            rows[row] = 1;
+
+            for (size_t j = 1; j < i; j++)
+                rows[row + j] = rows[prev + j - 1] + rows[prev + j];
+
+            rows[row + i] = 1;
+        }
+
+        return rows;
+    }
+
+    //Compile time triangle, S > 0:
+    //
+
+    template <typename T, size_t S = 0> class PascalTriangle
+    {
+    public:
+        static constexpr array<T, PascalOffset(S)> rows = GeneratePascalRows<T, S>();
+
+        constexpr size_t size() const { return S; }
+
+        constexpr const T* Row(size_t dx) const { return rows.data() + PascalOffset(dx); }
+
+        span<const T> operator[](size_t dx) const
+        {
+            return span<const T>(Row(dx), dx + 1);
+        }
+    };
+
+    //Runtime triangle, either owns its rows or views a compile time triangle:
+    //
+
+    template <typename T> class PascalTriangle<T, 0>
+    {
+    public:
+        PascalTriangle(size_t height) : height(height), data(PascalOffset(height))
+        {
+            if (!height)
+                return;
+
+            data[0] = 1;
 
             for (size_t i = 1; i < height; i++)
             {
-                data[i].reserve(i + 1);
-                data[i].push_back(1);
+                const T* prev = Row(i - 1);
+                T* row = data.data() + PascalOffset(i);
+
+                row[0] = 1;
 
                 for (size_t j = 1; j < i; j++)
-                    data[i].push_back(data[i - 1][j - 1] + data[i - 1][j]);
+                    row[j] = prev[j - 1] + prev[j];
 
-                data[i].push_back(1);
+                row[i] = 1;
             }
         }
 
+        template <size_t S> PascalTriangle(const PascalTriangle<T, S>& fixed) : height(S), table(fixed.Row(0)) {}
+
+        static constexpr size_t Offset(size_t dx) { return PascalOffset(dx); }
+
         size_t size() const
         {
-            return data.size();
+            return height;
+        }
+
+        const T* Row(size_t dx) const
+        {
+            return ((table) ? table : data.data()) + Offset(dx);
         }
 
-        const vector<T>& operator[](size_t dx) const
+        span<const T> operator[](size_t dx) const
         {
-            return data[dx];
+            return span<const T>(Row(dx), dx + 1);
         }
 
-        vector<vector<T>>& Mutate() { return data; }
+        //Compile time rows are read only, mutation is only supported on an owned triangle.
+        //
+
+        span<T> Mutate(size_t dx) { return span<T>(data.data() + Offset(dx), dx + 1); }
+
+        //Heap bytes owned, a view of a compile time triangle owns none.
+        //
+
+        size_t Allocated() const { return data.capacity() * sizeof(T); }
 
     private:
-        vector<vector<T>> data;
+        size_t height;
+        const T* table = nullptr;
+        aligned_vector<T> data;
     };
 
+    template <typename T, size_t S> PascalTriangle<T> GeneratePascal()
+    {
+        if constexpr (is_integral<T>() && S > 0 && S <= static_pascal_limit)
+            return PascalTriangle<T>(PascalTriangle<T, S>());
+        else
+            return PascalTriangle<T>(S);
+    }
+
+
+    //Vector kernels need the operand in one contiguous run, shims that synthesize values fall back to scalar:
+    //
+
+    template <typename I, typename = void> struct is_contiguous : false_type {};
+    template <typename I> struct is_contiguous<I, void_t<decltype(declval<const I&>().data())>> : true_type {};
 
     template <typename T, typename I, typename O> void ToPascal(const I& data, O& output, const PascalTriangle<T>& triangle)
     {
+        if constexpr (simd::supported<T> && is_contiguous<I>::value)
+        {
+            if (simd::PascalRows<T>(triangle.Row(0), (const T*)data.data(), data.size(), output.data(), data.size()))
+                return;
+        }
+
         for (size_t i = 0; i < data.size(); i++)
         {
-            output[i] = 0;
-            for (size_t j = 0; j < triangle[i].size(); j++)
-                output[i] += triangle[i][j] * data[j];
+            const T* row = triangle.Row(i);
+
+            T s = 0;
+            for (size_t j = 0; j <= i; j++)
+                s += row[j] * data[j];
+
+            output[i] = s;
         }
     }
 
@@ -109,11 +323,19 @@ namespace d88
 
     template <typename T> void ExecutePascal(const span<T>& data, const span<T>& output, const PascalTriangle<T>& triangle)
     {
+        if constexpr (simd::supported<T>)
+        {
+            if (simd::PascalRows<T>(triangle.Row(0), data.data(), data.size(), output.data(), (output.size() < triangle.size()) ? output.size() : triangle.size()))
+                return;
+        }
+
         for (size_t i = 0; i < output.size() && i < triangle.size(); i++)
         {
+            const T* row = triangle.Row(i);
+
             T s = 0;
-            for (size_t j = 0; j < triangle[i].size(); j++)
-                s += triangle[i][j] * data[j];
+            for (size_t j = 0; j <= i; j++)
+                s += row[j] * data[j];
 
             output[i] = s;
         }
@@ -121,14 +343,22 @@ namespace d88
 
     template <typename T> void ExecutePolarPascal(const span<T>& data, const span<T>& output, const PascalTriangle<T>& triangle)
     {
+        if constexpr (simd::supported<T>)
+        {
+            if (simd::PascalRows<T>(triangle.Row(0), data.data(), data.size(), output.data(), output.size(), true))
+                return;
+        }
+
         for (size_t i = 0; i < output.size(); i++)
         {
+            const T* row = triangle.Row(i);
+
             T s = 0;
-            for (size_t j = 0; j < triangle[i].size() && j < data.size(); j++)
+            for (size_t j = 0; j <= i && j < data.size(); j++)
             {
                 T d = ((((i % 2) && !(j % 2)) || (!(i % 2) && (j % 2))) ? -1 : 1);
-                s += triangle[i][j] * d * data[j];
-            }       
+                s += row[j] * d * data[j];
+            }
 
             output[i] = s;
         }
@@ -138,11 +368,25 @@ namespace d88
 
     template <typename T> void ToPascalR(const span<T>& data, const span<T>& output, const PascalTriangle<T>& triangle)
     {
+        if constexpr (simd::supported<T>)
+        {
+            auto isa = simd::Active();
+
+            if (isa != simd::isa_t::scalar)
+            {
+                reverse_copy(data.begin(), data.end(), output.begin());
+                simd::PascalRows<T>(triangle.Row(0), output.data(), output.size(), output.data(), output.size(), false, 0, isa);
+                return;
+            }
+        }
+
         for (size_t i = 0,k = data.size()-1; i < data.size(); i++)
         {
+            const T* row = triangle.Row(i);
+
             T s = 0;
-            for (size_t j = 0; j < triangle[i].size(); j++)
-                s += triangle[i][j] * data[k-j];
+            for (size_t j = 0; j <= i; j++)
+                s += row[j] * data[k-j];
 
             output[i] = s;
         }
@@ -150,13 +394,27 @@ namespace d88
 
     template <typename T> void ToPascalPolarR(const span<T>& data, const span<T>& output, const PascalTriangle<T>& triangle)
     {
+        if constexpr (simd::supported<T>)
+        {
+            auto isa = simd::Active();
+
+            if (isa != simd::isa_t::scalar)
+            {
+                reverse_copy(data.begin(), data.end(), output.begin());
+                simd::PascalRows<T>(triangle.Row(0), output.data(), output.size(), output.data(), output.size(), true, 0, isa);
+                return;
+            }
+        }
+
         for (size_t i = 0, k = data.size() - 1; i < data.size(); i++)
         {
+            const T* row = triangle.Row(i);
+
             T s = 0;
-            for (size_t j = 0; j < triangle[i].size(); j++)
+            for (size_t j = 0; j <= i; j++)
             {
                 T d = ((((i % 2) && !(j % 2)) || (!(i % 2) && (j % 2))) ? -1 : 1);
-                T v = triangle[i][j] * d * data[k - j];
+                T v = row[j] * d * data[k - j];
                 s += v;
             }
 
@@ -164,17 +422,133 @@ namespace d88
         }
     }
 
-    template <typename T> void ToPascalParallel(const span<T>& data, const span<T>& output, const PascalTriangle<T>& triangle)
+    //Intra block parallelism:
+    //Work is cut into one contiguous range of rows per worker holding an equal share of multiply-adds, row i costing a + b * i.
+    //
+
+    constexpr size_t parallel_block = 2048;
+
+    inline size_t ParallelWorkers()
+    {
+        size_t n = thread::hardware_concurrency();
+
+        return (n) ? n : 1;
+    }
+
+    inline vector<size_t> BalancedRows(size_t n, size_t a, size_t b, size_t parts = ParallelWorkers())
+    {
+        if (parts > n) parts = n;
+        if (!parts) parts = 1;
+
+        vector<size_t> cut(parts + 1, n);
+        cut[0] = 0;
+
+        double total = (double)n * a + (double)b * n * (n - 1) / 2, acc = 0;
+
+        for (size_t i = 0, k = 1; i < n && k < parts; i++)
+        {
+            acc += (double)a + (double)b * i;
+
+            if (acc * parts >= total * k)
+                cut[k++] = i + 1;
+        }
+
+        return cut;
+    }
+
+    //Ranges run on the pool the caller is already a worker of, where they stay inline, otherwise on the shared pool:
+    //
+
+    template <typename F> void ParallelRows(const vector<size_t>& cut, F f)
     {
-        for_each(execution::par_unseq, data.begin(), data.end(), [&](auto&& item) mutable
+        if (cut.size() == 2)
+            f(cut[0], cut[1]);
+        else
+        {
+            auto pool = ThreadPool::Current();
+
+            ((pool) ? *pool : SharedPool()).For(cut.size() - 1, 1, [&](size_t, size_t first, size_t last)
             {
-                size_t i = &item - data.data();
+                for (size_t k = first; k < last; k++)
+                    f(cut[k], cut[k + 1]);
+            });
+        }
+    }
+
+    template <typename T> void ToPascalParallel(const span<const T>& data, const span<T>& output, const PascalTriangle<T>& triangle)
+    {
+        ParallelRows(BalancedRows(data.size(), 1, 1), [&](size_t first, size_t last)
+        {
+            if constexpr (simd::supported<T>)
+            {
+                if (simd::PascalRows<T>(triangle.Row(0), data.data(), data.size(), output.data(), last, false, first))
+                    return;
+            }
+
+            for (size_t i = first; i < last; i++)
+            {
+                const T* row = triangle.Row(i);
+
                 T s = 0;
-                for (size_t j = 0; j < triangle[i].size(); j++)
-                    s += triangle[i][j] * data[j];
+                for (size_t j = 0; j <= i; j++)
+                    s += row[j] * data[j];
 
                 output[i] = s;
-            });
+            }
+        });
+    }
+
+    //Difference table kernels:
+    //The binomial transform and its signed inverse built from adjacent additions or subtractions only, no triangle and no multiplies.
+    //The table is kept mirrored in the output so every pass is a forward stream, term i settles at output[n - 1 - i] after pass i.
+    //
+
+    template <typename T, bool POLAR> void DifferencePasses(T* o, size_t n)
+    {
+        for (size_t i = 1; i < n; i++)
+        {
+            for (size_t k = 0; k < n - i; k++)
+            {
+                if constexpr (POLAR)
+                    o[k] = o[k] - o[k + 1];
+                else
+                    o[k] = o[k] + o[k + 1];
+            }
+        }
+
+        reverse(o, o + n);
+    }
+
+    template <typename T, typename I, typename O> void ToPascalDifference(const I& data, O& output)
+    {
+        for (size_t i = 0, k = output.size() - 1; i < output.size(); i++, k--)
+            output[k] = (i < data.size()) ? data[i] : T(0);
+
+        DifferencePasses<T, false>(output.data(), output.size());
+    }
+
+    template <typename T, typename I, typename O> void ExecutePolarPascalDifference(const I& data, O& output)
+    {
+        for (size_t i = 0, k = output.size() - 1; i < output.size(); i++, k--)
+            output[k] = (i < data.size()) ? data[i] : T(0);
+
+        DifferencePasses<T, true>(output.data(), output.size());
+    }
+
+    template <typename T, typename I, typename O> void ToPascalDifferenceR(const I& data, O& output)
+    {
+        for (size_t i = 0, k = data.size() - output.size(); i < output.size(); i++, k++)
+            output[i] = data[k];
+
+        DifferencePasses<T, false>(output.data(), output.size());
+    }
+
+    template <typename T, typename I, typename O> void ToPascalPolarDifferenceR(const I& data, O& output)
+    {
+        for (size_t i = 0, k = data.size() - output.size(); i < output.size(); i++, k++)
+            output[i] = data[k];
+
+        DifferencePasses<T, true>(output.data(), output.size());
     }
 
     template <typename T> vector<T> AsPascal(const span<T>& data, const PascalTriangle<T>& triangle)
@@ -186,52 +560,95 @@ namespace d88
         return result;
     }
 
+    //Rows of the difference table are one contiguous aligned buffer, row major.
+    //All height rows are defined but only [first, height) are stored, rows before first are rolled through a scratch pair and dropped.
+    //
+
     template <typename T> class ElectiveSymmetry
     {
     public:
-        ElectiveSymmetry(const span<T>& sym, size_t height=0)
+        ElectiveSymmetry(const span<T>& sym, size_t height = 0, size_t first = 0)
+        {
+            Assign(sym, height, first);
+        }
+
+        //Rebuilds in place, the buffer is reused when the shape does not grow.
+        //
+
+        void Assign(const span<T>& sym, size_t height = 0, size_t first = 0)
         {
             if (!height)height = sym.size();
 
-            _data.resize(height);
+            _width = sym.size();
+            _height = height;
+            _first = (first < height) ? first : height;
 
-            {
-                T first = sym[0];
-                if (first % 2 == 0)
-                    ++first;
+            _data.resize((_height - _first) * _width);
 
-                T inv(0);
-                inv -= first;
+            T f = sym[0];
+            if (f % 2 == 0)
+                ++f;
 
-                for (size_t i = 0; i < height; i++)
-                {
-                    _data[i].reserve(sym.size());
-                    _data[i].push_back(i % 2 ? inv : first);
-                }
-            }
+            T inv(0);
+            inv -= f;
 
-            for (size_t i = 1; i < sym.size(); i++)
+            aligned_vector<T> roll((_first) ? 2 * _width : 0);
+
+            T* prev = nullptr;
+
+            for (size_t j = 0; j < _height; j++)
             {
-                for (size_t j = 0; j < height; j++)
+                T* row = (j >= _first) ? _data.data() + (j - _first) * _width : roll.data() + (j % 2) * _width;
+
+                if (j == 0)
+                {
+                    row[0] = f;
+                    for (size_t i = 1; i < _width; i++)
+                        row[i] = sym[i];
+                }
+                else
                 {
-                    if (j == 0)
-                        _data[j].push_back(sym[i]);
-                    else
-                        _data[j].push_back((_data[j - 1][i - 1] - _data[j - 1][i]));
+                    row[0] = (j % 2) ? inv : f;
+                    for (size_t i = 1; i < _width; i++)
+                        row[i] = prev[i - 1] - prev[i];
                 }
+
+                prev = row;
             }
         }
 
-        size_t size() const { return _data.size(); }
-        const vector<T>& operator[](size_t dx) const { return _data[dx]; }
+        size_t size() const { return _height; }
+        size_t width() const { return _width; }
+        size_t first() const { return _first; }
+
+        //Rows are absolute, only [first(), size()) are stored:
+        //
+
+        span<const T> operator[](size_t dx) const
+        {
+            Expects(dx >= _first && dx < _height);
+
+            return span<const T>(_data.data() + (dx - _first) * _width, _width);
+        }
+
+        span<T> operator[](size_t dx)
+        {
+            Expects(dx >= _first && dx < _height);
+
+            return span<T>(_data.data() + (dx - _first) * _width, _width);
+        }
+
+        ElectiveSymmetry& Mutate() { return *this; }
+        ElectiveSymmetry Duplicate() const { return *this; }
 
-        vector<vector<T>>& Mutate() { return _data; }
-        vector<vector<T>> Duplicate() { return _data; }
+        const T* data() const { return _data.data(); }
 
-        const vector<vector<T>>& data() const { return _data; }
+        size_t Allocated() const { return _data.capacity() * sizeof(T); }
 
     private:
-        vector<vector<T>> _data;
+        size_t _width = 0, _height = 0, _first = 0;
+
+        aligned_vector<T> _data;
     };
 
     template <typename T> T GetInverse(T i)
@@ -240,6 +657,20 @@ namespace d88
             return i.MultiplicativeInverse();
         else
         {
+            //Odd values are their own inverse mod 8 and each Newton step doubles the correct low bits, no big number needed:
+            //
+
+            if (i % 2)
+            {
+                using U = conditional_t<(sizeof(T) < sizeof(unsigned)), unsigned, T>;
+
+                U x = i, u = i;
+                while ((T)(x * u) != 1)
+                    x = (T)(x * (U(2) - u * x));
+
+                return (T)x;
+            }
+
             T t = -1;
             switch (t)
             {
@@ -256,6 +687,9 @@ namespace d88
         }
     }
 
+    //Row i of the transform is the symmetry prefix [0, i] with the first term made odd, so the symmetry is kept once and rows are views into it.
+    //
+
     template <typename T> class ElectiveTransform
     {
     public:
@@ -267,42 +701,80 @@ namespace d88
 
         void Init(const span<T>& sym)
         {
-            data.clear();
+            size_t n = sym.size();
 
             T first = sym[0];
             if (first % 2 == 0)
                 ++first;
 
-            data.resize(sym.size());
-            for (size_t i = 0; i < sym.size(); i++)
-            {
-                for (size_t j = 0; j < i + 1; j++)
-                    data[i].push_back((j==0) ? first : sym[j]);
-            }
+            coefficients.assign(sym.begin(), sym.end());
+            coefficients[0] = first;
+
+            _inverse = 0;
 
-            if (data[0][0] != 1)
+            if (coefficients[0] != 1)
             {
-                _inverse = GetInverse(data[0][0]);
+                _inverse = GetInverse(coefficients[0]);
 
-                T tst = _inverse; tst = tst * data[0][0];
+                T tst = _inverse; tst = tst * coefficients[0];
                 if (tst != 1)
                     throw "TODO HANDLE GCD FAILURE!";
             }
+
+            //Solve rows, output[i] = base * Diagonal(i) - sum Solve(i)[p] * output[p], p < i.
+            //With an inverse row i needs inverse * sym[i - p], which reads forward from n - 1 - i in the reversed, pre-scaled copy.
+            //Without one every row is sym[p] for p >= 1.
+            //
+
+            reversed = (bool)_inverse;
+
+            diagonal.assign(n, T(1));
+
+            if (reversed)
+            {
+                solve.assign(n - 1, T(0));
+
+                for (size_t k = 0; k + 1 < n; k++)
+                    solve[k] = coefficients[n - 1 - k] * _inverse;
+
+                for (size_t i = 0; i < n; i++)
+                    diagonal[i] = _inverse;
+            }
+            else
+            {
+                solve.assign(coefficients.begin(), coefficients.end());
+                solve[0] = 0;
+
+                for (size_t i = 1; i < n; i++)
+                    diagonal[i] -= coefficients[i];
+            }
         }
 
-        size_t size() const { return data.size(); }
+        size_t size() const { return coefficients.size(); }
 
-        const vector<T>& operator[](size_t dx) const
+        span<const T> operator[](size_t dx) const
         {
-            return data[dx];
+            return span<const T>(coefficients.data(), dx + 1);
         }
 
         T inverse() const { return _inverse; }
 
+        //Pre-scaled coefficients of output[0..i), in the order they are solved.
+        //
+
+        const T* Solve(size_t dx) const { return solve.data() + ((reversed) ? solve.size() - dx : 0); }
+        const T& Diagonal(size_t dx) const { return diagonal[dx]; }
+
+        size_t Allocated() const { return (coefficients.capacity() + solve.capacity() + diagonal.capacity()) * sizeof(T); }
+
     private:
         T _inverse = 0;
+        bool reversed = false;
 
-        vector<vector<T>> data;
+        vector<T> coefficients;
+
+        aligned_vector<T> solve;
+        vector<T> diagonal;
     };
 
     template < typename T, size_t S > vector<T> ImportSymmetry1(const span<T>& source)
@@ -322,36 +794,64 @@ namespace d88
         return ImportSymmetry1<T, S>(span<T>((T*)hash.data(),hash.size()/sizeof(T)));
     }
 
-    template <typename T> void ToPolynomial(const span<T>& _pascal, const span<T>& output, const ElectiveTransform<T>& et)
+    constexpr size_t polynomial_tile = 256;
+
+    //Blocked forward substitution. Rows of a tile first take the solved prefix one column tile at a time, so that tile of output stays in L1,
+    //then finish serially against their own tile.
+    //
+
+    template <typename T> void ToPolynomial(const span<const T>& _pascal, const span<T>& output, const ElectiveTransform<T>& et, bool P = false)
     {
-        if (et.inverse()) //is the constant term of the poly not 1
+        size_t n = output.size();
+        T* o = output.data();
+
+        auto sub = [&](T& acc, const T* r, const T* x, size_t len)
         {
-            for (size_t i = 0, k = _pascal.size() - 1; i < output.size(); i++, k--)
+            if constexpr (std::is_class<T>())
             {
-                output[i] = _pascal[k]; output[i] *= et.inverse();
-                for (size_t j = et[i].size() - 1, p = 0; j > 0; j--, p++)
-                {
-                    if constexpr (std::is_class<T>())
-                        output[i].FM3IAD(et[i][j],output[p],et.inverse());
-                    else
-                        output[i] += ((T)0) - (et[i][j] * output[p] * et.inverse());
-                }
-                    
+                for (size_t p = 0; p < len; p++)
+                    acc.FM2IAD(r[p], x[p]);
             }
-        }
-        else
+            else if constexpr (simd::supported<T>)
+                acc -= simd::Dot<T>(r, x, len);
+            else
+            {
+                for (size_t p = 0; p < len; p++)
+                    acc -= r[p] * x[p];
+            }
+        };
+
+        for (size_t i0 = 0; i0 < n; i0 += polynomial_tile)
         {
-            for (size_t i = 0; i < output.size(); i++)
+            size_t i1 = (i0 + polynomial_tile < n) ? i0 + polynomial_tile : n;
+
+            for (size_t i = i0; i < i1; i++)
+            {
+                o[i] = (et.inverse()) ? _pascal[_pascal.size() - 1 - i] : _pascal[i];
+                o[i] *= et.Diagonal(i);
+            }
+
+            //Every row of the tile takes the same i0 terms from the prefix, so parallel rows split it evenly:
+            //
+
+            auto prefix = [&](size_t first, size_t last)
             {
-                output[i] = _pascal[i];
-                for (size_t j = et[i].size() - 1; j > 0; j--)
+                for (size_t j0 = 0; j0 < i0; j0 += polynomial_tile)
                 {
-                    if constexpr (std::is_class<T>())
-                        output[i].FM2IAD(et[i][j], output[j]);
-                    else
-                        output[i] += ((T)0) - (et[i][j] * output[j]);
+                    size_t j1 = (j0 + polynomial_tile < i0) ? j0 + polynomial_tile : i0;
+
+                    for (size_t i = first; i < last; i++)
+                        sub(o[i], et.Solve(i) + j0, o + j0, j1 - j0);
                 }
-            }
+            };
+
+            if (P && i0)
+                ParallelRows(BalancedRows(i1 - i0, 1, 0), [&](size_t first, size_t last) { prefix(i0 + first, i0 + last); });
+            else
+                prefix(i0, i1);
+
+            for (size_t i = i0; i < i1; i++)
+                sub(o[i], et.Solve(i) + i0, o + i0, i - i0);
         }
     }
 
@@ -363,29 +863,28 @@ namespace d88
         return result;
     }
 
-    template<typename T> void ToFunction(const span<T>& polynomial, const span<T>& output,const ElectiveSymmetry<T>& es,bool P = false)
+    template<typename T> void ToFunction(const span<const T>& polynomial, const span<T>& output,const ElectiveSymmetry<T>& es,bool P = false)
     {
         auto core = [&](size_t k, size_t i)
         {
+            const T* row = es[i].data();
             output[k] = 0;
 
             for (size_t j = 0, p = polynomial.size() - 1; j < polynomial.size(); j++, p--)
             {
                 if constexpr (std::is_class<T>())
-                    output[k].FMADD(es[i][p], polynomial[j]);
+                    output[k].FMADD(row[p], polynomial[j]);
                 else
-                    output[k] += es[i][p] * polynomial[j];
+                    output[k] += row[p] * polynomial[j];
             }
         };
 
         if (P)
         {
-            std::atomic<size_t> identity = 0;
-            std::for_each_n(std::execution::par, output.data(), es.size() - es.size() - output.size(), [&](auto v)
+            ParallelRows(BalancedRows(output.size(), 1, 0), [&](size_t first, size_t last)
             {
-                auto k = identity++;
-
-                core(k, es.size() - output.size() + k);
+                for (size_t k = first; k < last; k++)
+                    core(k, es.size() - output.size() + k);
             });
         }
         else
@@ -397,25 +896,24 @@ namespace d88
     {
         auto core = [&](size_t k, size_t i)
         {
+            const T* row = es[i].data();
             output[k] = 0;
 
             for (size_t j = 0; j < polynomial.size(); j++)
             {
                 if constexpr (std::is_class<T>())
-                    output[k].FMADD(es[i][j], polynomial[j]);
+                    output[k].FMADD(row[j], polynomial[j]);
                 else
-                    output[k] += es[i][j] * polynomial[j];
+                    output[k] += row[j] * polynomial[j];
             }
         };
 
         if (P)
         {
-            std::atomic<size_t> identity = 0;
-            std::for_each_n(std::execution::par, output.data(), (es.size() - offset) - (es.size() - output.size() - offset), [&](auto v)
+            ParallelRows(BalancedRows(output.size(), 1, 0), [&](size_t first, size_t last)
             {
-                auto k = identity++;
-                
-                core(k, es.size() - output.size() - offset + k);
+                for (size_t k = first; k < last; k++)
+                    core(k, es.size() - output.size() - offset + k);
             });
         }
         else
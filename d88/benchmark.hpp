@@ -11,6 +11,14 @@
 #include "hash.hpp"
 #include "util.hpp"
 #include "correct.hpp"
+#include "api.hpp"
+
+#include <cstdio>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "d8u/random.hpp"
 #include "scalar_t/int.hpp"
@@ -133,6 +141,36 @@ namespace d88
             progressBar += s.iterations();  progressBar.display();
         }
 
+        template <typename T, size_t S> void to_pascal(picobench::state& s)
+        {
+            auto source = d8u::random::Vector<T>(S);
+            vector<T> dest(S);
+
+            auto pt = GeneratePascal<T, S>();
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                    ToPascal<T>(source, dest, pt);
+            }
+            progressBar += s.iterations();  progressBar.display();
+        }
+
+        template <typename T, size_t S> void to_pascal_difference(picobench::state& s)
+        {
+            auto source = d8u::random::Vector<T>(S);
+            vector<T> dest(S);
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                    ToPascalDifference<T>(source, dest);
+            }
+            progressBar += s.iterations();  progressBar.display();
+        }
+
         template <typename T, size_t S,size_t EX> void extend_short(picobench::state& s)
         {
             auto data = d8u::random::Vector<T>(S);
@@ -151,6 +189,109 @@ namespace d88
             progressBar += s.iterations();  progressBar.display();
         }
 
+        //64 chunks of 1024 bytes through the multi block kernels, plain against tweaked per chunk whitening:
+        //
+
+        template <bool W, bool D> void multi_chunk(picobench::state& s)
+        {
+            using T = unsigned long long;
+            constexpr size_t S = 128, chunks = 64;
+
+            auto source = d8u::random::Vector<T>(S * chunks);
+            vector<T> dest(S * chunks);
+
+            auto ec = api::default_context_cache().Get<EncryptContextLong<T, S>, T, S>("password");
+            auto dc = api::default_context_cache().Get<DecryptContextShort<T, S>, T, S>("password");
+            TweakKey tweak("password");
+
+            {
+                picobench::scope scope(s);
+
+                for (auto _ : s)
+                {
+                    if constexpr (D && W)
+                        multi_block_decrypt_tweaked<T, S>(source, dest, *dc, tweak, 0);
+                    else if constexpr (D)
+                        multi_block_decrypt_short<T, S>(source, dest, *dc);
+                    else if constexpr (W)
+                        multi_block_encrypt_tweaked<T, S>(source, dest, *ec, tweak, 0);
+                    else
+                        multi_block_encrypt_long<T, S>(source, dest, *ec);
+                }
+            }
+            progressBar += s.iterations();  progressBar.display();
+        }
+
+        auto enc64k = multi_chunk<false, false>;
+        auto enc64kt = multi_chunk<true, false>;
+        auto dec64k = multi_chunk<false, true>;
+        auto dec64kt = multi_chunk<true, true>;
+
+        //Whole file encrypt/protect from a cold page cache, mmap against O_DIRECT + io_uring streams:
+        //
+
+        static const size_t cold_file_size = 64 * 1024 * 1024 + 100;
+
+        inline const char* cold_file()
+        {
+            static bool made = false;
+
+            if (!made)
+            {
+                auto data = d8u::random::Vector<uint8_t>(cold_file_size);
+
+                std::FILE* f = std::fopen("bench_cold.in", "wb");
+                std::fwrite(data.data(), 1, data.size(), f);
+                std::fclose(f);
+
+                made = true;
+            }
+
+            return "bench_cold.in";
+        }
+
+        inline void evict(const char* path)
+        {
+#if defined(__linux__)
+            int fd = open(path, O_RDONLY);
+
+            if (fd < 0)
+                return;
+
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+#endif
+        }
+
+        template <bool D, bool P> void cold_file_op(picobench::state& s)
+        {
+            options_t options;
+            options.direct = D;
+
+            auto input = cold_file();
+
+            evict(input);
+            evict("bench_cold.out");
+
+            {
+                picobench::scope scope(s);
+                for (auto _ : s)
+                {
+                    if (P)
+                        api::default_protect(input, "bench_cold.out", options);
+                    else
+                        api::default_encrypt(input, "bench_cold.out", "password", options);
+                }
+            }
+            progressBar += s.iterations();  progressBar.display();
+        }
+
+        auto encrypt_mmap = cold_file_op<false, false>;
+        auto encrypt_direct = cold_file_op<true, false>;
+        auto protect_mmap = cold_file_op<false, true>;
+        auto protect_direct = cold_file_op<true, true>;
+
         auto extsh64x64 = extend_short<unsigned long long, 8,4>;
         auto extsh1024x64 = extend_short<unsigned long long, 128,4>;
 
@@ -178,6 +319,13 @@ namespace d88
         auto enc4096x64 = encrypt_long<unsigned long long, 512>;
         auto enc16kx64 = encrypt_long<unsigned long long, 2048>;
 
+        auto pascal128 = to_pascal<unsigned long long, 128>;
+        auto pascal512 = to_pascal<unsigned long long, 512>;
+        auto pascal2048 = to_pascal<unsigned long long, 2048>;
+        auto pascald128 = to_pascal_difference<unsigned long long, 128>;
+        auto pascald512 = to_pascal_difference<unsigned long long, 512>;
+        auto pascald2048 = to_pascal_difference<unsigned long long, 2048>;
+
         auto enc1024x32s = encrypt_short<unsigned int, 256>;
         auto enc1024x64s = encrypt_short<unsigned long long, 128>;
 
@@ -233,6 +381,40 @@ namespace d88
         PICOBENCH(enc16kx64);*/
 
 
+        PICOBENCH_SUITE("pascal triangle vs difference table, 128 words");
+
+        PICOBENCH(pascal128).baseline();
+        PICOBENCH(pascald128);
+
+        PICOBENCH_SUITE("pascal triangle vs difference table, 512 words");
+
+        PICOBENCH(pascal512).baseline();
+        PICOBENCH(pascald512);
+
+        PICOBENCH_SUITE("pascal triangle vs difference table, 2048 words");
+
+        PICOBENCH(pascal2048).baseline();
+        PICOBENCH(pascald2048);
+
+
+        PICOBENCH_SUITE("encrypt 64 x 1024 byte chunks, untweaked vs tweaked");
+
+        PICOBENCH(enc64k).iterations({ 64, 256 }).baseline();
+        PICOBENCH(enc64kt).iterations({ 64, 256 });
+
+        PICOBENCH_SUITE("decrypt 64 x 1024 byte chunks, untweaked vs tweaked");
+
+        PICOBENCH(dec64k).iterations({ 64, 256 }).baseline();
+        PICOBENCH(dec64kt).iterations({ 64, 256 });
+
+        PICOBENCH_SUITE("64MB file from cold cache, mmap vs O_DIRECT + io_uring");
+
+        PICOBENCH(encrypt_mmap).iterations({ 1 }).samples(3).baseline();
+        PICOBENCH(encrypt_direct).iterations({ 1 }).samples(3);
+        PICOBENCH(protect_mmap).iterations({ 1 }).samples(3);
+        PICOBENCH(protect_direct).iterations({ 1 }).samples(3);
+
+
     }
 
 }
@@ -0,0 +1,161 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <iostream>
+
+#include "../clipp.h"
+
+#include "api.hpp"
+#include "factor.hpp"
+
+namespace d88::cli
+{
+    //Parses the command line and runs one operation, returns the process exit code.
+    //
+
+    inline int run(int argc, char* argv[])
+    {
+        using namespace std;
+        using namespace clipp;
+
+        bool gen = false, protect = false, recover = false, _static = false, encrypt = false, decrypt = false, solve = false,compare=false,reverse_static=false,forward_static=false,stream=false,update=false,verify=false;
+        string in_file = "", out_file = "", middle = "static", key ="password", profile = "4k", ranges = "";
+        d88::options_t options;
+        size_t offset = 0, length = 0;
+
+        auto cli = (
+            option("-e", "--encrypt").set(encrypt).doc("Encrypt File"),
+            option("-f", "--forward").set(forward_static).doc("Execute static forward"),
+            option("-z", "--reverse").set(reverse_static).doc("Execute static reverse"),
+            option("-d", "--decrypt").set(decrypt).doc("Decrypt File"),
+            option("-s", "--static").set(_static).doc("Compute static difference"),
+            option("-p", "--protect").set(protect).doc("Encode a recovery context"),
+            option("-r", "--recover").set(recover).doc("Validate and recover file"),
+            option("-y", "--verify").set(verify).doc("Check file against its recovery context without repairing"),
+            option("-u", "--update").set(update).doc("With --protect, patch only the chunks of an existing recovery context that changed"),
+            option("--ranges") & value("With --update, file of changed offset length pairs instead of a scan", ranges),
+            option("-g", "--gensym").set(gen).doc("Print symmetry"),
+            option("-c", "--compare").set(compare).doc("Compare Files"),
+            option("-v", "--gensol").set(solve).doc("Print solution"),
+            option("-k", "--key") & value("Password", key),
+            option("-i", "--input") & value("Input File, - for stdin", in_file),
+            option("-m", "--middle") & value("Intermediate File", middle),
+            option("-o", "--output") & value("Output File, - for stdout", out_file),
+            option("-t", "--threads") & value("Worker threads, 0 for all", options.threads),
+            option("--grain") & value("Chunks per task, 0 for auto", options.grain),
+            option("--pin").set(options.pin).doc("Pin workers to cores"),
+            option("--stream").set(stream).doc("Encrypt/decrypt through bounded buffers, implied by - for stdin/stdout"),
+            option("--buffer") & value("Bytes per stream buffer, 0 for 1MiB", options.buffer),
+            option("--direct").set(options.direct).doc("Encrypt/decrypt/protect files with O_DIRECT + io_uring instead of mmap"),
+            option("--tweak").set(options.tweak).doc("Whiten each encrypted chunk with its index, must also be given to decrypt"),
+            option("--profile") & value("Protection profile: 4k, 1k, 16k, 64k, 4k-lean or 4k32", profile),
+            option("--offset") & value("With --decrypt and --length, first plain text byte to decrypt", offset),
+            option("--length") & value("With --decrypt, decrypt only this many bytes from --offset", length)
+            );
+
+        if (!parse(argc, argv, cli)) cout << make_man_page(cli, argv[0]);
+        else
+        {
+            if (in_file == "-" || out_file == "-")
+                stream = true;
+
+            //Unknown profile names, foreign parity headers and mismatched parity all surface as thrown messages, report them instead of letting them end the process.
+            //
+
+            try
+            {
+                options.profile = d88::api::find_profile(profile);
+
+                if (gen)
+                {
+                    d88::api::print_sym();
+                }
+                else if (compare)
+                {
+                    if (d88::api::compare_files_bytes(in_file, out_file))
+                        std::cout << "Files are the same." << std::endl;
+                    else
+                        std::cout << "Files are DIFFERENT! NOT THE SAME." << std::endl;
+                }
+                else if (solve)
+                {
+                    d88::api::print_solution();
+                }
+                else if (encrypt)
+                {
+                    if (stream)
+                        d88::api::stream_encrypt(in_file, out_file, key, options);
+                    else
+                        d88::api::default_encrypt(in_file, out_file, key, options);
+                }
+                else if (decrypt)
+                {
+                    if (length)
+                        d88::api::range_decrypt(in_file, out_file, key, offset, length, options);
+                    else if (stream)
+                        d88::api::stream_decrypt(in_file, out_file, key, options);
+                    else
+                        d88::api::default_decrypt(in_file, out_file, key, options);
+                }
+                else if (_static)
+                {
+                    d88::api::generate_static(in_file, out_file, middle, options);
+                }
+                else if (reverse_static)
+                {
+                    d88::api::forward_static(in_file, middle, out_file, options);
+                }
+                else if (forward_static)
+                {
+                    d88::api::reverse_static(in_file, middle,out_file, options);
+                }
+                else if (protect)
+                {
+                    if (update && ranges.size())
+                        std::cout << d88::api::default_reprotect(in_file, out_file, d88::api::load_byte_ranges(ranges), options) << " chunks updated." << std::endl;
+                    else if (update)
+                        std::cout << d88::api::default_reprotect(in_file, out_file, options) << " chunks updated." << std::endl;
+                    else
+                        d88::api::default_protect(in_file, out_file, options);
+                }
+                else if (recover)
+                {
+                    d88::api::default_recover(in_file, out_file, options);
+                }
+                else if (verify)
+                {
+                    auto bad = d88::api::default_verify(in_file, out_file, options);
+
+                    for (auto& run : bad.Runs())
+                        std::cout << "Corrupt chunks " << run.first * bad.chunk << " => " << (run.first + run.second) * bad.chunk << std::endl;
+
+                    std::cout << bad.Count() << " of " << bad.chunks << " chunks failed validation." << std::endl;
+
+                    if (bad.Count())
+                        return 1;
+                }
+            }
+            catch (const char* e)
+            {
+                cerr << e;
+
+                if (string_view(e) == "Unknown protection profile.")
+                {
+                    cerr << " Expected one of:";
+
+                    for (auto name : d88::api::profile_names)
+                        cerr << " " << name;
+                }
+
+                cerr << endl;
+
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+}
\ No newline at end of file
@@ -3,10 +3,12 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <utility>
 
 #include "base.hpp"
+#include "solve.hpp"
 #include "util.hpp"
 
 using namespace std;
@@ -25,7 +27,7 @@ namespace d88
             return c;
         }
 
-        template < typename A, typename B > void row_add_eq(A& a, const B& b)
+        template < typename A, typename B > void row_add_eq(A&& a, const B& b)
         {
             for (size_t i = 0; i < a.size(); i++)
                 a[i] += b[i];
@@ -53,7 +55,32 @@ namespace d88
                 a[i] -= b[i] * s;
         }
 
-        template <typename T> void row_solve(vector<vector<T>> & m, span<T> s)
+        //Solves through the dense LU engine, false with m and s untouched when m is singular mod 2.
+        //
+
+        template <typename T, typename M> bool lu_solve(M & m, span<T> s)
+        {
+            size_t n = m.size();
+
+            ScratchFrame scratch;
+            auto a = scratch.Take<T>(n * n), dinv = scratch.Take<T>(n), work = scratch.Take<T>(n);
+            auto perm = scratch.Take<size_t>(n);
+
+            for (size_t i = 0; i < n; i++)
+                copy(m[i].begin(), m[i].begin() + n, a.begin() + i * n);
+
+            if (!FactorLU<T>(a, n, perm, dinv))
+                return false;
+
+            SolveLU<T>(a, n, perm, dinv, s, work);
+
+            return true;
+        }
+
+        //The original in place elimination with its even pivot handling, only systems singular mod 2 reach it.
+        //
+
+        template <typename T, typename M> void row_eliminate(M & m, span<T> s)
         {
             auto Inverse = [&](size_t i)
             {
@@ -134,6 +161,12 @@ namespace d88
             }
         }
 
+        template <typename T, typename M> void row_solve(M & m, span<T> s)
+        {
+            if (!lu_solve<T>(m, s))
+                row_eliminate<T>(m, s);
+        }
+
 
         /*template <typename T, size_t S, size_t E> class ExtendPascalContext
         {
@@ -217,12 +250,12 @@ namespace d88
         template <typename T, size_t S, size_t E> class ExtendShortContext
         {
         public:
-            ExtendShortContext(const span<T>& sym) : /*et(sym),*/ es(sym, S * 2) {}
+            ExtendShortContext(const span<T>& sym) : /*et(sym),*/ es(sym, S * 2, S) {}
 
             //const ElectiveTransform<T>& Transform() const { return et; }
             const ElectiveSymmetry<T>& Symmetry() const { return es; }
 
-            vector<vector<T>> & Mutate() { return es.Mutate(); }
+            ElectiveSymmetry<T>& Mutate() { return es.Mutate(); }
 
         private:
             //ElectiveTransform<T> et;
@@ -244,7 +277,7 @@ namespace d88
         Solution for all rows is valid ever S rows. If we are not keeping all S we must combine them so solution is present in E blocks instead.
         */
 
-        template <typename T, size_t S, size_t E> void InterleaveElectiveMatrix(vector<vector<T>>& s, const span<T>& temp)
+        template <typename T, size_t S, size_t E> void InterleaveElectiveMatrix(ElectiveSymmetry<T>& s, const span<T>& temp)
         {
             //Solve matrix for even / odd identity
             for (size_t i = 0; i < S; i++)
@@ -300,7 +333,7 @@ namespace d88
             }
         }
 
-        template <typename T, size_t S, size_t E> vector<pair<size_t, size_t>> MapInterleaveElectiveMatrix(vector<vector<T>>& s)
+        template <typename T, size_t S, size_t E> vector<pair<size_t, size_t>> MapInterleaveElectiveMatrix(ElectiveSymmetry<T>& s)
         {
             vector<pair<size_t, size_t>> result;
 
@@ -366,7 +399,7 @@ namespace d88
                 column[ab.first] += column[ab.second];
         }
 
-        template <typename T, size_t S, size_t E> void ComputeInterleaveElectiveMatrix(vector<vector<T>>& s)
+        template <typename T, size_t S, size_t E> void ComputeInterleaveElectiveMatrix(ElectiveSymmetry<T>& s)
         {
             //Solve matrix for even / odd identity
             for (size_t i = 0; i < S; i++)
@@ -432,7 +465,7 @@ namespace d88
         template <typename T, size_t S, size_t E> class ImmutableShortContext
         {
         public:
-            ImmutableShortContext(const span<T>& sym) : es(sym, S * 2) 
+            ImmutableShortContext(const span<T>& sym) : es(sym, S * 2, S) 
             {
                 auto copy = es.Duplicate();
                 map = MapInterleaveElectiveMatrix<T,S,E>(copy);
@@ -450,7 +483,7 @@ namespace d88
         template <typename T, size_t S, size_t E> class StaticShortContext
         {
         public:
-            StaticShortContext(const span<T>& sym) : es(sym, S * 2)
+            StaticShortContext(const span<T>& sym) : es(sym, S * 2, S)
             {
                 auto copy = es.Duplicate();
                 map = MapInterleaveElectiveMatrix<T, S, E>(copy);
@@ -465,7 +498,7 @@ namespace d88
             ElectiveSymmetry<T> es;
         };
 
-        template<typename T, size_t S, size_t E,size_t C=0> void immutable_extend_short(const span<T>& source, const span<T>& temp, const span<T>& dest, ImmutableShortContext<T, S, E>& ctx)
+        template<typename T, size_t S, size_t E,size_t C=0> void immutable_extend_short(const span<const T>& source, const span<T>& temp, const span<T>& dest, ImmutableShortContext<T, S, E>& ctx)
         {
             ToFunctionR<T>(source, temp, ctx.Symmetry());
 
@@ -481,7 +514,7 @@ namespace d88
         template <typename T, size_t S, size_t E> class RecoverShortContext
         {
         public:
-            RecoverShortContext(const span<T>& sym) : es(sym, S * 2) 
+            RecoverShortContext(const span<T>& sym) : es(sym, S * 2, S) 
             {
                 auto & s = es.Mutate();
                 ComputeInterleaveElectiveMatrix<T, S, E>(s);
@@ -550,32 +583,42 @@ namespace d88
            
         */
 
+        //The erased rows and the reduced system are views into the thread's scratch arena, a repair takes nothing from the heap once it is warm.
+        //
+
         template<typename T, size_t S, size_t E> void recover_short(const span<T> & source, const span<T>& dx, RecoverShortContext<T, S, E>& ctx)
         {
-            vector<vector<T>> m;
-            vector<T> s , t;
-            auto es = ctx.Symmetry();
+            const auto& es = ctx.Symmetry();
+            ScratchFrame scratch;
 
+            size_t n = 0;
             for (size_t i = 0; i < dx.size(); i++)
+                if (dx[i] != i)
+                    n++;
+
+            auto m = scratch.Take<const T*>(n);
+            auto s = scratch.Take<T>(n), s2 = scratch.Take<T>(n);
+            auto t = scratch.Take<size_t>(n);
+            auto cells = scratch.Take<T>(n * n);
+            auto m2 = scratch.Take<span<T>>(n);
+
+            for (size_t i = 0, k = 0; i < dx.size(); i++)
             {
                 if (dx[i] != i)
                 {
-                    m.push_back(es[dx[i]]);
-                    s.push_back(source[i]);
+                    m[k] = es[dx[i]].data();
+                    s[k] = source[i];
                     source[i] = 0;
-                    t.push_back(i);
+                    t[k++] = i;
                 }
             }
 
-            vector<vector<T>> m2(m.size());
-            vector<T> s2;
-
-            for (size_t i = 0; i < m.size(); i++)
+            for (size_t i = 0; i < n; i++)
             {
                 if (m[i][t[i]] % 2 == 0)
                 {
                     size_t swapdx = -1;
-                    for (size_t j = i+1; j < t.size(); j++)
+                    for (size_t j = i+1; j < n; j++)
                     {
                         if (m[j][t[i]] % 2 != 0)
                         {
@@ -591,39 +634,291 @@ namespace d88
                     swap(s[i], s[swapdx]);
                 }
 
+                //Erased columns were zeroed above, so they drop out of the dot product:
+                //
+
                 T sum = 0;
                 for (size_t j = 0; j < source.size(); j++)
+                    sum += (((T)0) - source[j]*m[i][j]);
+
+                m2[i] = cells.subspan(i * n, n);
+
+                for (size_t k = 0; k < n; k++)
+                    m2[i][k] = m[i][t[k]];
+
+                s2[i] = sum+s[i];
+            }
+
+            //LU needs no normalised rows. The elimination was always handed a unit diagonal, the swap above made every pivot odd:
+            //
+
+            if (!lu_solve<T>(m2, s2))
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    T inv = GetInverse<T>(m2[i][i]);
+                    row_mul_eq(m2[i], inv);
+                    s2[i] *= inv;
+                }
+
+                row_eliminate<T>(m2, s2);
+            }
+
+            for (size_t i = 0; i < n; i++)
+                source[t[i]] = s2[i];
+        }
+
+        //Everything a window repair needs that depends only on the symmetry: the first E + C interleaved rows, which are exactly what
+        //immutable_extend_short computes, and per window the inverse of the E x E block the first E rows form over the window's columns.
+        //A window attempt is then a handful of E x E products that also predict every check word, only a candidate that matches them is fully validated.
+        //Windows whose block is singular mod 2 keep the recover_short path.
+        //
+
+        template <typename T, size_t S, size_t E, size_t C = 0> class RepairPlan
+        {
+        public:
+            RepairPlan(const span<T>& sym) : rctx(sym), rows((E + C) * S), inverses((S - E) * E * E), invertible(S - E), pivot(S), pivot_inverse(S), parity(S)
+            {
+                const auto& es = rctx.Symmetry();
+
+                for (size_t k = 0; k < E + C; k++)
+                    copy(es[S + k].begin(), es[S + k].begin() + S, rows.begin() + k * S);
+
+                for (size_t i = 0; i < S - E; i++)
+                    invertible[i] = Invert(i);
+
+                //First odd entry of every column, a single word error is read off that row of the syndrome:
+                //
+
+                for (size_t j = 0; j < S; j++)
                 {
-                    for (size_t k = 0; k < t.size(); k++)
+                    pivot[j] = E + C;
+
+                    for (size_t k = 0; k < E + C; k++)
                     {
-                        if (j == t[k])
+                        if (Row(k)[j] % 2)
                         {
-                            m2[i].push_back(m[i][j]);
-                            goto CONTINUE;
+                            pivot[j] = k;
+                            pivot_inverse[j] = GetInverse<T>(Row(k)[j]);
+                            break;
                         }
                     }
+                }
 
-                    sum += (((T)0) - source[j]*m[i][j]);
+                //Columns by their low bits over the first mask_rows rows, so a pair search only visits columns that fit the syndrome mod 2:
+                //
+
+                for (size_t j = 0; j < S; j++)
+                {
+                    parity[j] = LowBits(j);
 
-                CONTINUE:
-                    continue;
+                    if (pivot[j] != E + C)
+                        by_parity.emplace_back(parity[j], j);
                 }
 
-                s2.push_back(sum+s[i]);
+                sort(by_parity.begin(), by_parity.end());
             }
 
-            for (size_t i = 0; i < m2.size(); i++)
+            const T* Row(size_t k) const { return rows.data() + k * S; }
+
+            bool Invertible(size_t i) const { return invertible[i]; }
+
+            RecoverShortContext<T, S, E>& Context() { return rctx; }
+
+            //dots holds the products of the damaged source with every row, only the window's own terms are swapped out.
+            //Writes the window's solution to x and returns whether it reproduces all E + C words of ex:
+            //
+
+            bool Recover(size_t i, const span<T>& source, const span<T>& ex, const T* dots, T* x) const
             {
-                size_t inv = GetInverse<T>(m2[i][i]);
-                row_mul_eq(m2[i], inv);
-                s2[i] *= inv;
+                std::array<T, E + C> known;
+
+                for (size_t k = 0; k < E + C; k++)
+                {
+                    known[k] = dots[k];
+                    const T* row = Row(k);
+
+                    for (size_t l = 0; l < E; l++)
+                        known[k] -= row[i + l] * source[i + l];
+                }
+
+                const T* inv = inverses.data() + i * E * E;
+
+                for (size_t l = 0; l < E; l++)
+                {
+                    x[l] = 0;
+
+                    for (size_t k = 0; k < E; k++)
+                        x[l] += inv[l * E + k] * (ex[k] - known[k]);
+                }
+
+                for (size_t k = 0; k < E + C; k++)
+                {
+                    T sum = known[k];
+                    const T* row = Row(k);
+
+                    for (size_t l = 0; l < E; l++)
+                        sum += row[i + l] * x[l];
+
+                    if (sum != ex[k])
+                        return false;
+                }
+
+                return true;
             }
 
-            row_solve<T>(m2, s2);
+            //The syndrome of an error e is the rows times e. A single word error makes it a multiple of one column, a pair a combination of two,
+            //solved from two rows whose 2 x 2 block is odd. f(at, value, ...) hears each candidate that explains every syndrome word and returns true to stop.
+            //
+            //A solvable pair has columns that differ mod 2. Shifted down by its lowest set bit the syndrome is then odd somewhere, and its low bits are
+            //either the low bits of one column, when only that word's error reaches the lowest bit, or of both columns added. Only columns that fit are solved,
+            //about S lookups instead of S^2 / 2 solves, so a chunk damaged beyond any pair fails as quickly as it does for single words.
+            //
+
+            template <typename F> bool LocateOne(const T* sigma, F f) const
+            {
+                for (size_t j = 0; j < S; j++)
+                {
+                    if (pivot[j] == E + C)
+                        continue;
 
-            for (size_t i = 0; i < t.size(); i++)
-                source[t[i]] = s2[i];
-        }
+                    T e = T(sigma[pivot[j]] * pivot_inverse[j]);
+
+                    if (Explains(sigma, j, e, j, T(0)) && f(j, e))
+                        return true;
+                }
+
+                return false;
+            }
+
+            template <typename F> bool LocatePair(const T* sigma, F f) const
+            {
+                T low = 0;
+
+                for (size_t k = 0; k < E + C; k++)
+                    low |= sigma[k];
+
+                if (!low)
+                    return false;
+
+                size_t shift = 0;
+                while (!((low >> shift) & 1)) shift++;
+
+                uint64_t target = 0;
+
+                for (size_t k = 0; k < mask_rows; k++)
+                    target |= uint64_t((sigma[k] >> shift) & 1) << k;
+
+                auto attempt = [&](size_t a, size_t b)
+                {
+                    T ea, eb;
+
+                    if (a > b)
+                        std::swap(a, b);
+
+                    return SolvePair(sigma, a, b, ea, eb) && ea != 0 && eb != 0 && Explains(sigma, a, ea, b, eb) && f(a, ea, b, eb);
+                };
+
+                for (size_t a = 0; a < S; a++)
+                {
+                    if (pivot[a] == E + C)
+                        continue;
+
+                    //Only a's error reaches the lowest bit, b is anywhere:
+                    //
+
+                    if (parity[a] == target)
+                    {
+                        for (auto& [m, b] : by_parity)
+                            if (m != parity[a] && attempt(a, b))
+                                return true;
+
+                        continue;
+                    }
+
+                    //Both do, b's low bits make up the rest:
+                    //
+
+                    auto range = equal_range(by_parity.begin(), by_parity.end(), pair<uint64_t, size_t>(target ^ parity[a], 0), [](auto& l, auto& r) { return l.first < r.first; });
+
+                    for (auto it = range.first; it != range.second; it++)
+                        if (it->second > a && attempt(a, it->second))
+                            return true;
+                }
+
+                return false;
+            }
+
+        private:
+            static constexpr size_t mask_rows = (E + C < 64) ? E + C : 64;
+
+            uint64_t LowBits(size_t j) const
+            {
+                uint64_t m = 0;
+
+                for (size_t k = 0; k < mask_rows; k++)
+                    m |= uint64_t(Row(k)[j] & 1) << k;
+
+                return m;
+            }
+
+            bool Invert(size_t i)
+            {
+                DenseLU<T> lu(rows.data() + i, E, S);
+
+                if (!lu.Ready())
+                    return false;
+
+                lu.Inverse(inverses.data() + i * E * E);
+
+                return true;
+            }
+
+            bool Explains(const T* sigma, size_t a, T ea, size_t b, T eb) const
+            {
+                for (size_t k = 0; k < E + C; k++)
+                    if (T(Row(k)[a] * ea + ((a == b) ? T(0) : T(Row(k)[b] * eb))) != sigma[k])
+                        return false;
+
+                return true;
+            }
+
+            bool SolvePair(const T* sigma, size_t a, size_t b, T& ea, T& eb) const
+            {
+                for (size_t r1 = 0; r1 < E + C; r1++)
+                {
+                    for (size_t r2 = r1 + 1; r2 < E + C; r2++)
+                    {
+                        T a1 = Row(r1)[a], b1 = Row(r1)[b], a2 = Row(r2)[a], b2 = Row(r2)[b];
+                        T det = T(a1 * b2 - b1 * a2);
+
+                        if (det % 2 == 0)
+                            continue;
+
+                        T d = GetInverse<T>(det);
+
+                        ea = T(d * T(b2 * sigma[r1] - b1 * sigma[r2]));
+                        eb = T(d * T(a1 * sigma[r2] - a2 * sigma[r1]));
+
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            RecoverShortContext<T, S, E> rctx;
+
+            vector<T> rows;
+            vector<T> inverses;
+            vector<uint8_t> invertible;
+
+            vector<size_t> pivot;
+            vector<T> pivot_inverse;
+
+            vector<uint64_t> parity;
+            vector<pair<uint64_t, size_t>> by_parity;
+        };
 
         template <typename T,size_t S, size_t E,size_t C=0> bool validate_short(const span<T>& source, const span<T>& temp, const span<T>& ex, const span<T>& ex_temp, ExtendShortContext<T, S, E>& ctx)
         {
@@ -632,7 +927,7 @@ namespace d88
             return equal(ex_temp.begin(), ex_temp.end(), ex.begin());
         }
 
-        template <typename T, size_t S, size_t E,size_t C=0> bool validate_immutable_short(const span<T>& source, const span<T>& temp, const span<T>& ex, const span<T>& ex_temp, ImmutableShortContext<T, S, E>& ctx)
+        template <typename T, size_t S, size_t E,size_t C=0> bool validate_immutable_short(const span<const T>& source, const span<T>& temp, const span<const T>& ex, const span<T>& ex_temp, ImmutableShortContext<T, S, E>& ctx)
         {
             immutable_extend_short<T, S, E,C>(source, temp, ex_temp, ctx);
 
@@ -642,20 +937,24 @@ namespace d88
         template <typename T, size_t S, size_t E, size_t W,size_t C> bool repair_quick(const span<T>& source, const span<T>& temp1, const span<T>& temp2, const span<T>& ex, const span<T>& ex_temp, const span<T>& sym)
         {
             ImmutableShortContext<T,S,E> ctx(sym);
+            RecoverShortContext<T, S, E> rctx(sym);
+
+            ScratchFrame scratch;
+            auto dx = scratch.Take<T>(S);
 
             for (size_t i = 0; i < S-E; i += W)
             {
                 copy(source.begin(), source.end(), temp1.begin());
 
-                auto dx = GenerateSequence<T>(S);
+                for (size_t j = 0; j < S; j++)
+                    dx[j] = j;
+
                 for (size_t j = 0; j < E; j++)
                 {
                     dx[i + j] = S + j;
                     temp1[i + j] = ex[j];
                 }
 
-                RecoverShortContext<T, S, E> rctx(sym);
-
                 recover_short<T, S, E>(temp1, dx, rctx);
 
                 if (validate_immutable_short<T, S, E,C>(temp1, temp2, ex, ex_temp, ctx))
@@ -670,19 +969,24 @@ namespace d88
 
         template <typename T, size_t S, size_t E, size_t W, size_t C> bool repair_quick2(const span<T>& source, const span<T>& temp1, const span<T>& temp2, const span<T>& ex, const span<T>& ex_temp, const span<T>& sym, ImmutableShortContext<T, S, E> &ctx)
         {
+            RecoverShortContext<T, S, E> rctx(sym);
+
+            ScratchFrame scratch;
+            auto dx = scratch.Take<T>(S);
+
             for (size_t i = 0; i < S - E; i += W)
             {
                 copy(source.begin(), source.end(), temp1.begin());
 
-                auto dx = GenerateSequence<T>(S);
+                for (size_t j = 0; j < S; j++)
+                    dx[j] = j;
+
                 for (size_t j = 0; j < E; j++)
                 {
                     dx[i + j] = S + j;
                     temp1[i + j] = ex[j];
                 }
 
-                RecoverShortContext<T, S, E> rctx(sym);
-
                 recover_short<T, S, E>(temp1, dx, rctx);
 
                 if (validate_immutable_short<T, S, E, C>(temp1, temp2, ex, ex_temp, ctx))
@@ -695,12 +999,123 @@ namespace d88
             return false;
         }
 
+        //The products of the damaged source with every plan row, shared by all of its window attempts:
+        //
+
+        template <typename T, size_t S, size_t E, size_t C> void repair_dots(const span<T>& source, const span<T>& dots, const RepairPlan<T, S, E, C>& plan)
+        {
+            for (size_t k = 0; k < E + C; k++)
+            {
+                T sum = 0;
+                const T* row = plan.Row(k);
+
+                for (size_t j = 0; j < S; j++)
+                    sum += source[j] * row[j];
+
+                dots[k] = sum;
+            }
+        }
+
+        //One window attempt, leaves the candidate in temp1 and never touches source so attempts can run side by side:
+        //
+
+        template <typename T, size_t S, size_t E, size_t C> bool repair_window(size_t i, const span<T>& source, const span<T>& temp1, const span<T>& temp2, const span<T>& ex, const span<T>& ex_temp, const T* dots, RepairPlan<T, S, E, C>& plan, ImmutableShortContext<T, S, E>& ctx)
+        {
+            copy(source.begin(), source.end(), temp1.begin());
+
+            if (plan.Invertible(i))
+            {
+                if (!plan.Recover(i, source, ex, dots, temp1.data() + i))
+                    return false;
+            }
+            else
+            {
+                ScratchFrame scratch;
+                auto dx = scratch.Take<T>(S);
+
+                for (size_t j = 0; j < S; j++)
+                    dx[j] = j;
+
+                for (size_t j = 0; j < E; j++)
+                {
+                    dx[i + j] = S + j;
+                    temp1[i + j] = ex[j];
+                }
+
+                recover_short<T, S, E>(temp1, dx, plan.Context());
+            }
+
+            return validate_immutable_short<T, S, E, C>(temp1, temp2, ex, ex_temp, ctx);
+        }
+
+        template <typename T, size_t S, size_t E, size_t W, size_t C> bool repair_quick2(const span<T>& source, const span<T>& temp1, const span<T>& temp2, const span<T>& ex, const span<T>& ex_temp, RepairPlan<T, S, E, C>& plan, ImmutableShortContext<T, S, E>& ctx)
+        {
+            ScratchFrame scratch;
+            auto dots = scratch.Take<T>(E + C);
+
+            repair_dots<T, S, E, C>(source, dots, plan);
+
+            for (size_t i = 0; i < S - E; i += W)
+            {
+                if (repair_window<T, S, E, C>(i, source, temp1, temp2, ex, ex_temp, dots.data(), plan, ctx))
+                {
+                    copy(temp1.begin(), temp1.end(), source.begin());
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        //Scattered errors of one or two words anywhere in the chunk, located from the syndrome rather than searched window by window.
+        //
+
+        template <typename T, size_t S, size_t E, size_t C> bool repair_scattered(size_t words, const span<T>& source, const span<T>& temp1, const span<T>& temp2, const span<T>& ex, const span<T>& ex_temp, RepairPlan<T, S, E, C>& plan, ImmutableShortContext<T, S, E>& ctx)
+        {
+            ScratchFrame scratch;
+            auto sigma = scratch.Take<T>(E + C);
+
+            repair_dots<T, S, E, C>(source, sigma, plan);
+
+            for (size_t k = 0; k < E + C; k++)
+                sigma[k] -= ex[k];
+
+            auto attempt = [&](size_t a, T ea, size_t b, T eb)
+            {
+                copy(source.begin(), source.end(), temp1.begin());
+
+                temp1[a] -= ea;
+                temp1[b] -= eb;
+
+                return validate_immutable_short<T, S, E, C>(temp1, temp2, ex, ex_temp, ctx);
+            };
+
+            bool found = (words == 1) ? plan.LocateOne(sigma.data(), [&](size_t a, T ea) { return attempt(a, ea, a, T(0)); }) : plan.LocatePair(sigma.data(), attempt);
+
+            if (found)
+                copy(temp1.begin(), temp1.end(), source.begin());
+
+            return found;
+        }
+
+        //Single words first, then bursts of up to E words, then scattered pairs:
+        //
+
+        template <typename T, size_t S, size_t E, size_t C> bool repair_locate(const span<T>& source, const span<T>& temp1, const span<T>& temp2, const span<T>& ex, const span<T>& ex_temp, RepairPlan<T, S, E, C>& plan, ImmutableShortContext<T, S, E>& ctx)
+        {
+            return repair_scattered<T, S, E, C>(1, source, temp1, temp2, ex, ex_temp, plan, ctx)
+                || repair_quick2<T, S, E, 1, C>(source, temp1, temp2, ex, ex_temp, plan, ctx)
+                || repair_scattered<T, S, E, C>(2, source, temp1, temp2, ex, ex_temp, plan, ctx);
+        }
+
         template <typename T, size_t S, size_t E, size_t C> bool repair_quick_m(const span<T>& source, const span<T>& ex, const span<T>& sym, ImmutableShortContext<T, S, E>& ctx)
         {
             std::atomic<bool> solved = false;
 
+            RecoverShortContext<T, S, E> rctx(sym);
+
             std::atomic<size_t> identity = 0;
-            for_each_n(execution::par_unseq, source.data(), S - E, [&](auto v)
+            for_each_n(execution::par, source.data(), S - E, [&](auto v)
             {
                 auto i = identity++;
 
@@ -709,9 +1124,9 @@ namespace d88
                 //Thread Local Storage:
                 //
 
-                std::vector<T> temp1(source.size());
-                std::vector<T> temp2(source.size());
-                std::vector<T> ex_temp(ex.size());
+                ScratchFrame scratch;
+                auto temp1 = scratch.Take<T>(source.size()), temp2 = scratch.Take<T>(source.size());
+                auto ex_temp = scratch.Take<T>(ex.size()), dx = scratch.Take<T>(S);
 
                 //Duplicated from source:
                 //
@@ -721,7 +1136,9 @@ namespace d88
                 //Target thread(i) permutation:
                 //
 
-                auto dx = GenerateSequence<T>(S);
+                for (size_t j = 0; j < S; j++)
+                    dx[j] = j;
+
                 for (size_t j = 0; j < E; j++)
                 {
                     dx[i + j] = S + j;
@@ -730,10 +1147,6 @@ namespace d88
 
                 if (solved) return; //Exit thread As Soon As a Solution is found.
 
-                RecoverShortContext<T, S, E> rctx(sym);
-
-                if (solved) return; //Exit thread As Soon As a Solution is found.
-
                 recover_short<T, S, E>(temp1, dx, rctx);
 
                 if (solved) return; //Exit thread As Soon As a Solution is found.
@@ -0,0 +1,509 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base.hpp"
+#include "options.hpp"
+#include "stream.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+#endif
+
+namespace d88
+{
+#if defined(__linux__)
+
+    //Minimal io_uring over the raw syscalls, one thread queues, submits and reaps.
+    //Ready() is false when the kernel refuses a ring or its probe does not list IORING_OP_READ and IORING_OP_WRITE (before 5.6), callers then fall back to pread/pwrite.
+    //
+
+    class uring
+    {
+    public:
+        explicit uring(unsigned entries)
+        {
+            io_uring_params p;
+            std::memset(&p, 0, sizeof(p));
+
+            fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+
+            if (fd < 0)
+                return;
+
+            sq_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+            bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+
+            if (single)
+                sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+
+            sq = (uint8_t*)mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            cq = (single) ? sq : (uint8_t*)mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+            sqe_bytes = p.sq_entries * sizeof(io_uring_sqe);
+            sqes = (io_uring_sqe*)mmap(nullptr, sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+            if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED)
+            {
+                Release();
+                return;
+            }
+
+            sq_head = (unsigned*)(sq + p.sq_off.head);
+            sq_tail = (unsigned*)(sq + p.sq_off.tail);
+            sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+            sq_array = (unsigned*)(sq + p.sq_off.array);
+
+            cq_head = (unsigned*)(cq + p.cq_off.head);
+            cq_tail = (unsigned*)(cq + p.cq_off.tail);
+            cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+            cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+            if (!Supports(IORING_OP_READ) || !Supports(IORING_OP_WRITE))
+                Release();
+        }
+
+        ~uring()
+        {
+            Release();
+        }
+
+        uring(const uring&) = delete;
+        uring& operator=(const uring&) = delete;
+
+        bool Ready() const { return fd >= 0; }
+
+        void Queue(uint8_t op, int file, void* p, unsigned n, uint64_t offset, uint64_t tag)
+        {
+            unsigned tail = *sq_tail;
+            unsigned i = tail & sq_mask;
+
+            io_uring_sqe& e = sqes[i];
+            std::memset(&e, 0, sizeof(e));
+
+            e.opcode = op;
+            e.fd = file;
+            e.addr = (uint64_t)p;
+            e.len = n;
+            e.off = offset;
+            e.user_data = tag;
+
+            sq_array[i] = i;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+            queued++;
+        }
+
+        //Submits everything queued in one call and blocks until at least wait completions are ready:
+        //
+
+        void Submit(unsigned wait = 0)
+        {
+            while (queued || wait)
+            {
+                int r = (int)syscall(__NR_io_uring_enter, fd, queued, wait, (wait) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+                if (r < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    throw "io_uring submit error.";
+                }
+
+                //Nothing taken while requests are queued would spin forever:
+                //
+
+                if (r == 0 && queued)
+                    throw "io_uring submit error.";
+
+                queued -= (unsigned)r;
+                wait = 0;
+            }
+        }
+
+        bool Reap(uint64_t& tag, int& result)
+        {
+            unsigned head = *cq_head;
+
+            if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+                return false;
+
+            const io_uring_cqe& c = cqes[head & cq_mask];
+
+            tag = c.user_data;
+            result = c.res;
+
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+
+            return true;
+        }
+
+    private:
+        //IORING_REGISTER_PROBE arrived with the plain read and write opcodes, a kernel that rejects the probe has neither.
+        //
+
+        bool Supports(uint8_t op)
+        {
+            constexpr unsigned count = 256;
+
+            std::vector<uint8_t> buffer(sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op));
+            auto probe = (io_uring_probe*)buffer.data();
+
+            if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, count) < 0)
+                return false;
+
+            return op <= probe->last_op && op < probe->ops_len && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+
+        void Release()
+        {
+            if (sqes && sqes != MAP_FAILED) munmap(sqes, sqe_bytes);
+            if (cq && cq != MAP_FAILED && cq != sq) munmap(cq, cq_bytes);
+            if (sq && sq != MAP_FAILED) munmap(sq, sq_bytes);
+            if (fd >= 0) close(fd);
+
+            fd = -1;
+            sq = cq = nullptr;
+            sqes = nullptr;
+        }
+
+        int fd = -1;
+        unsigned queued = 0;
+
+        uint8_t* sq = nullptr, * cq = nullptr;
+        size_t sq_bytes = 0, cq_bytes = 0, sqe_bytes = 0;
+
+        io_uring_sqe* sqes = nullptr;
+        io_uring_cqe* cqes = nullptr;
+
+        unsigned* sq_head = nullptr, * sq_tail = nullptr, * sq_array = nullptr, sq_mask = 0;
+        unsigned* cq_head = nullptr, * cq_tail = nullptr, cq_mask = 0;
+    };
+
+    //Sequential file or block device stream that bypasses the page cache with O_DIRECT.
+    //Two aligned staging buffers alternate: while the caller drains one the other is already in flight, each as a batch of io_uring requests.
+    //A written stream is padded to the next aligned block on Flush and regular files are truncated back to the logical length.
+    //
+
+    class direct_file : public stream_io
+    {
+    public:
+        static constexpr size_t alignment = 4096;
+        static constexpr size_t segments = 4;
+        static constexpr size_t default_buffer = 1 << 20;
+
+        direct_file(std::string_view path, bool write, size_t buffer = 0) : ring(2 * segments), writing(write)
+        {
+            if (!buffer) buffer = default_buffer;
+
+            size = (buffer + alignment * segments - 1) / (alignment * segments) * (alignment * segments);
+
+            int flags = (write) ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+
+            fd = open(std::string(path).c_str(), flags | O_DIRECT | O_CLOEXEC, 0644);
+
+            //Filesystems without O_DIRECT (tmpfs) still get the aligned batched path:
+            //
+
+            if (fd < 0 && errno == EINVAL)
+                fd = open(std::string(path).c_str(), flags | O_CLOEXEC, 0644);
+
+            if (fd < 0)
+                throw "Unable to open stream.";
+
+            struct stat st;
+            regular = (fstat(fd, &st) == 0) && S_ISREG(st.st_mode);
+
+            for (auto& b : buffers)
+                b.data.resize(size);
+
+            if (!writing)
+            {
+                Fetch(0);
+                Fetch(1);
+            }
+        }
+
+        ~direct_file()
+        {
+            try
+            {
+                if (writing && !finished)
+                    Flush();
+
+                Wait(0);
+                Wait(1);
+            }
+            catch (...) {}
+
+            close(fd);
+        }
+
+        direct_file(const direct_file&) = delete;
+        direct_file& operator=(const direct_file&) = delete;
+
+        size_t Read(uint8_t* p, size_t n) override
+        {
+            size_t total = 0;
+
+            while (total < n)
+            {
+                auto& b = buffers[current];
+
+                Wait(current);
+
+                if (position == b.valid)
+                {
+                    if (b.valid < size)
+                        break;
+
+                    Fetch(current);
+
+                    current ^= 1;
+                    position = 0;
+                    continue;
+                }
+
+                size_t take = std::min(n - total, b.valid - position);
+
+                std::memcpy(p + total, b.data.data() + position, take);
+
+                position += take;
+                total += take;
+            }
+
+            return total;
+        }
+
+        void Write(const uint8_t* p, size_t n) override
+        {
+            while (n)
+            {
+                auto& b = buffers[current];
+
+                if (!position)
+                    Wait(current);
+
+                size_t take = std::min(n, size - position);
+
+                std::memcpy(b.data.data() + position, p, take);
+
+                position += take;
+                p += take;
+                n -= take;
+
+                if (position == size)
+                {
+                    Store(current, size);
+
+                    current ^= 1;
+                    position = 0;
+                }
+            }
+        }
+
+        void Flush() override
+        {
+            if (finished)
+                return;
+
+            finished = true;
+
+            size_t logical = offset + position;
+
+            if (position)
+            {
+                size_t padded = (position + alignment - 1) / alignment * alignment;
+
+                std::fill(buffers[current].data.begin() + position, buffers[current].data.begin() + padded, 0);
+
+                Store(current, padded);
+            }
+
+            Wait(0);
+            Wait(1);
+
+            if (regular && ftruncate(fd, (off_t)logical))
+                throw "Stream write error.";
+        }
+
+    private:
+        struct buffer_t
+        {
+            std::vector<uint8_t, aligned_allocator<uint8_t, alignment>> data;
+
+            bool busy = false;
+            size_t valid = 0;
+            size_t pending = 0;
+            size_t expected[segments] = {};
+            int result[segments] = {};
+        };
+
+        //Queues buffer i as up to segments requests at the running offset and submits them in one call:
+        //
+
+        void Issue(size_t i, uint8_t op, size_t bytes)
+        {
+            auto& b = buffers[i];
+            size_t piece = size / segments;
+
+            b.busy = true;
+            b.pending = 0;
+
+            for (size_t k = 0, at = 0; k < segments; k++, at += piece)
+            {
+                b.expected[k] = (at < bytes) ? std::min(piece, bytes - at) : 0;
+                b.result[k] = 0;
+
+                if (!b.expected[k])
+                    continue;
+
+                if (ring.Ready())
+                {
+                    ring.Queue(op, fd, b.data.data() + at, (unsigned)b.expected[k], offset + at, i * segments + k);
+                    b.pending++;
+                }
+                else
+                    b.result[k] = Sync(op, b.data.data() + at, b.expected[k], offset + at);
+            }
+
+            offset += bytes;
+
+            if (ring.Ready())
+                ring.Submit();
+        }
+
+        void Fetch(size_t i)
+        {
+            Issue(i, IORING_OP_READ, size);
+        }
+
+        void Store(size_t i, size_t bytes)
+        {
+            Issue(i, IORING_OP_WRITE, bytes);
+        }
+
+        int Sync(uint8_t op, uint8_t* p, size_t n, size_t at)
+        {
+            size_t done = 0;
+
+            while (done < n)
+            {
+                ssize_t r = (op == IORING_OP_READ) ? pread(fd, p + done, n - done, (off_t)(at + done)) : pwrite(fd, p + done, n - done, (off_t)(at + done));
+
+                if (r < 0 && errno == EINTR)
+                    continue;
+
+                if (r < 0)
+                    return -errno;
+
+                if (r == 0)
+                    break;
+
+                done += (size_t)r;
+            }
+
+            return (int)done;
+        }
+
+        //Blocks until buffer i has no requests in flight, then works out how much of it is valid:
+        //
+
+        void Wait(size_t i)
+        {
+            auto& b = buffers[i];
+
+            if (!b.busy)
+                return;
+
+            while (b.pending)
+            {
+                uint64_t tag;
+                int result;
+
+                if (!ring.Reap(tag, result))
+                {
+                    ring.Submit(1);
+                    continue;
+                }
+
+                auto& owner = buffers[tag / segments];
+
+                owner.result[tag % segments] = result;
+                owner.pending--;
+            }
+
+            b.busy = false;
+            b.valid = 0;
+
+            for (size_t k = 0; k < segments && b.expected[k]; k++)
+            {
+                if (b.result[k] < 0)
+                    throw (writing) ? "Stream write error." : "Stream read error.";
+
+                b.valid += (size_t)b.result[k];
+
+                if ((size_t)b.result[k] < b.expected[k])
+                {
+                    if (writing)
+                        throw "Stream write error.";
+
+                    break;
+                }
+            }
+        }
+
+        uring ring;
+
+        int fd = -1;
+        bool writing = false, regular = false, finished = false;
+
+        size_t size = 0, offset = 0;
+        size_t current = 0, position = 0;
+
+        buffer_t buffers[2];
+    };
+
+#endif
+
+    //Picks the stream a path and the options ask for, direct I/O only applies to real files and devices on Linux.
+    //
+
+    inline std::unique_ptr<stream_io> OpenStream(std::string_view path, bool write, const options_t& options)
+    {
+#if defined(__linux__)
+        if (options.direct && path != "-")
+            return std::make_unique<direct_file>(path, write, options.buffer);
+#endif
+
+        return std::make_unique<stream_file>(path, write);
+    }
+}
\ No newline at end of file
@@ -66,8 +66,8 @@ namespace d88
         template <typename T, size_t S> class EncryptContextLong
         {
         public:
-            EncryptContextLong() :pt(S) {}
-            EncryptContextLong(const span<T>& sym):pt(S),et(sym) {}
+            EncryptContextLong() :pt(GeneratePascal<T, S>()) {}
+            EncryptContextLong(const span<T>& sym):pt(GeneratePascal<T, S>()),et(sym) {}
 
             void Init(const span<T>& sym)
             {
@@ -77,8 +77,10 @@ namespace d88
             const PascalTriangle<T>& Pascal() const { return pt; }
             const ElectiveTransform<T>& Transform() const { return et; }
 
+            size_t Footprint() const { return sizeof(*this) + pt.Allocated() + et.Allocated(); }
+
         private:
-            PascalTriangle<T> pt;             //TODO compile time buffers and initialization
+            PascalTriangle<T> pt;
             ElectiveTransform<T> et;
         };
 
@@ -89,6 +91,8 @@ namespace d88
 
             const ElectiveTransform<T>& Transform() const { return et; }
 
+            size_t Footprint() const { return sizeof(*this) + et.Allocated(); }
+
         private:
 
             ElectiveTransform<T> et;
@@ -100,6 +104,8 @@ namespace d88
             DecryptContextShort(const span<T>& sym):es(sym,S) { }
 
             const ElectiveSymmetry<T>& Symmetry() const { return es; }
+
+            size_t Footprint() const { return sizeof(*this) + es.Allocated(); }
         private:
             ElectiveSymmetry<T> es;
         };
@@ -107,36 +113,250 @@ namespace d88
         template <typename T, size_t S> class DecryptContextLong
         {
         public:
-            DecryptContextLong(const span<T>& sym) :pt(S), es(sym, S) { }
+            DecryptContextLong(const span<T>& sym) :pt(GeneratePascal<T, S>()), es(sym, S) { }
 
             const ElectiveSymmetry<T>& Symmetry() const { return es; }
 
             const PascalTriangle<T>& Pascal() const { return pt; }
+
+            size_t Footprint() const { return sizeof(*this) + pt.Allocated() + es.Allocated(); }
         private:
-            PascalTriangle<T> pt;             //TODO compile time buffers and initialization
+            PascalTriangle<T> pt;
             ElectiveSymmetry<T> es;
         };
 
-        template <typename T, size_t S> void block_encrypt_long(const span<T> & source, const span<T>& scratch,const span<T> & dest, const EncryptContextLong<T,S> & context)
+        //D selects the multiplication free difference table kernel in place of the triangle rows, output is identical.
+        //Blocks of parallel_block terms or more split each stage across cores.
+        //
+
+        template <typename T, size_t S, bool D = false> void block_encrypt_long(const span<const T> & source, const span<T>& scratch,const span<T> & dest, const EncryptContextLong<T,S> & context)
         {
-            ToPascal<T>(source, scratch, context.Pascal());
-            ToPolynomial<T>(scratch, dest,  context.Transform());
+            if constexpr (D)
+                ToPascalDifference<T>(source, scratch);
+            else if constexpr (S >= parallel_block)
+                ToPascalParallel<T>(source, scratch, context.Pascal());
+            else
+                ToPascal<T>(source, scratch, context.Pascal());
+
+            ToPolynomial<T>(scratch, dest, context.Transform(), S >= parallel_block);
         }
 
-        template <typename T, size_t S> void block_decrypt_short(const span<T>& source, const span<T>& dest, const DecryptContextShort<T,S> & context)
+        template <typename T, size_t S> void block_decrypt_short(const span<const T>& source, const span<T>& dest, const DecryptContextShort<T,S> & context)
         {
-            ToFunction<T>(source, dest, context.Symmetry());
+            ToFunction<T>(source, dest, context.Symmetry(), S >= parallel_block);
         }
 
-        template <typename T, size_t S> void block_encrypt_short(const span<T>& source, const span<T>& dest, const EncryptContextShort<T, S>& context)
+        template <typename T, size_t S> void block_encrypt_short(const span<const T>& source, const span<T>& dest, const EncryptContextShort<T, S>& context)
         {
-            ToPolynomial<T>(source, dest, context.Transform());
+            ToPolynomial<T>(source, dest, context.Transform(), S >= parallel_block);
         }
 
-        template <typename T, size_t S> void block_decrypt_long(const span<T>& source, const span<T>& scratch, const span<T>& dest, const DecryptContextLong<T, S>& context)
+        template <typename T, size_t S, bool D = false> void block_decrypt_long(const span<const T>& source, const span<T>& scratch, const span<T>& dest, const DecryptContextLong<T, S>& context)
         {
-            ToFunction<T>(source, scratch, context.Symmetry());
-            ToPascal<T>(scratch, dest, context.Pascal());
+            ToFunction<T>(source, scratch, context.Symmetry(), S >= parallel_block);
+
+            if constexpr (D)
+                ToPascalDifference<T>(scratch, dest);
+            else if constexpr (S >= parallel_block)
+                ToPascalParallel<T>(scratch, dest, context.Pascal());
+            else
+                ToPascal<T>(scratch, dest, context.Pascal());
+        }
+
+        //Multi chunk forms take source.size() / S consecutive blocks and transpose groups of simd::Lanes<T>() of them into vector lanes.
+        //Left over blocks, or every block without a vector unit, go through the single block path. Temporaries come from the thread's scratch arena.
+        //
+
+        template <typename T, size_t S> void multi_block_encrypt_long(const span<const T>& source, const span<T>& dest, const EncryptContextLong<T, S>& context)
+        {
+            size_t blocks = source.size() / S, b = 0;
+            ScratchFrame scratch;
+
+            if constexpr (simd::supported<T>)
+            {
+                auto isa = simd::Active();
+                size_t lanes = simd::Lanes<T>(isa);
+
+                if (lanes > 1 && blocks >= lanes)
+                {
+                    T* a = scratch.Take<T>(lanes * S).data(), * c = scratch.Take<T>(lanes * S).data();
+
+                    for (; b + lanes <= blocks; b += lanes)
+                    {
+                        simd::Interleave<T>(source.data() + b * S, S, lanes, a);
+                        simd::PascalLanes<T>(isa, context.Pascal().Row(0), a, S, c);
+                        simd::PolynomialLanes<T>(isa, c, S, a, context.Transform());
+                        simd::Deinterleave<T>(a, S, lanes, dest.data() + b * S);
+                    }
+                }
+            }
+
+            auto temp = scratch.Take<T>((b < blocks) ? S : 0);
+
+            for (; b < blocks; b++)
+                block_encrypt_long<T, S>(source.subspan(b * S, S), temp, dest.subspan(b * S, S), context);
+        }
+
+        template <typename T, size_t S> void multi_block_decrypt_short(const span<const T>& source, const span<T>& dest, const DecryptContextShort<T, S>& context)
+        {
+            size_t blocks = source.size() / S, b = 0;
+            ScratchFrame scratch;
+
+            if constexpr (simd::supported<T>)
+            {
+                auto isa = simd::Active();
+                size_t lanes = simd::Lanes<T>(isa);
+
+                if (lanes > 1 && blocks >= lanes)
+                {
+                    T* a = scratch.Take<T>(lanes * S).data(), * c = scratch.Take<T>(lanes * S).data();
+                    const auto& es = context.Symmetry();
+
+                    for (; b + lanes <= blocks; b += lanes)
+                    {
+                        simd::Interleave<T>(source.data() + b * S, S, lanes, a);
+                        simd::FunctionLanes<T>(isa, a, S, c, es, es.size() - S, S);
+                        simd::Deinterleave<T>(c, S, lanes, dest.data() + b * S);
+                    }
+                }
+            }
+
+            for (; b < blocks; b++)
+                block_decrypt_short<T, S>(source.subspan(b * S, S), dest.subspan(b * S, S), context);
+        }
+
+        template <typename T, size_t S> void multi_block_decrypt_long(const span<const T>& source, const span<T>& dest, const DecryptContextLong<T, S>& context)
+        {
+            size_t blocks = source.size() / S, b = 0;
+            ScratchFrame scratch;
+
+            if constexpr (simd::supported<T>)
+            {
+                auto isa = simd::Active();
+                size_t lanes = simd::Lanes<T>(isa);
+
+                if (lanes > 1 && blocks >= lanes)
+                {
+                    T* a = scratch.Take<T>(lanes * S).data(), * c = scratch.Take<T>(lanes * S).data();
+                    const auto& es = context.Symmetry();
+
+                    for (; b + lanes <= blocks; b += lanes)
+                    {
+                        simd::Interleave<T>(source.data() + b * S, S, lanes, a);
+                        simd::FunctionLanes<T>(isa, a, S, c, es, es.size() - S, S);
+                        simd::PascalLanes<T>(isa, context.Pascal().Row(0), c, S, a);
+                        simd::Deinterleave<T>(a, S, lanes, dest.data() + b * S);
+                    }
+                }
+            }
+
+            auto temp = scratch.Take<T>((b < blocks) ? S : 0);
+
+            for (; b < blocks; b++)
+                block_decrypt_long<T, S>(source.subspan(b * S, S), temp, dest.subspan(b * S, S), context);
+        }
+
+        //Tweaked mode, the per block variation the note at the top asks for without a context per block.
+        //Block k is whitened around the shared context as C = E(P ^ a_k) + b_k, P = D(C - b_k) ^ a_k, with a_k and b_k S words of a splitmix stream
+        //keyed by the key and k. The masks are O(S) against the O(S^2) transform and blocks stay independent, so parallel and random access work unchanged.
+        //
+
+        class TweakKey
+        {
+        public:
+            TweakKey() {}
+
+            TweakKey(string_view key)
+            {
+                string salted = "d88 tweak ";
+                salted += key;
+
+                vector<unsigned char> hash(picosha2::k_digest_size);
+                picosha2::hash256(salted.begin(), salted.end(), hash.begin(), hash.end());
+
+                std::copy(hash.begin(), hash.begin() + sizeof(seed), (unsigned char*)seed);
+            }
+
+            template <typename T> void Masks(uint64_t k, T* a, T* b, size_t n) const
+            {
+                uint64_t x = seed[0] ^ Mix(seed[1] + k * golden);
+
+                for (size_t j = 0; j < n; j++)
+                {
+                    a[j] = T(Mix(x += golden));
+                    b[j] = T(Mix(x += golden));
+                }
+            }
+
+        private:
+            static constexpr uint64_t golden = 0x9e3779b97f4a7c15;
+
+            static uint64_t Mix(uint64_t z)
+            {
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+                return z ^ (z >> 31);
+            }
+
+            uint64_t seed[2] = {};
+        };
+
+        //first is the index of the first block of source, groups of lanes blocks are masked in scratch and run through the multi block kernels:
+        //
+
+        template <typename T, size_t S> void multi_block_encrypt_tweaked(const span<const T>& source, const span<T>& dest, const EncryptContextLong<T, S>& context, const TweakKey& tweak, uint64_t first)
+        {
+            size_t blocks = source.size() / S, lanes = simd::Lanes<T>(), group = (lanes > 1) ? lanes : 1;
+
+            ScratchFrame scratch;
+            auto in = scratch.Take<T>(group * S);
+            T* a = scratch.Take<T>(group * S).data(), * b = scratch.Take<T>(group * S).data(), * x = in.data();
+
+            for (size_t g = 0; g < blocks; g += group)
+            {
+                size_t n = (blocks - g < group) ? blocks - g : group;
+                const T* src = source.data() + g * S;
+                T* dst = dest.data() + g * S;
+
+                for (size_t i = 0; i < n; i++)
+                    tweak.Masks<T>(first + g + i, a + i * S, b + i * S, S);
+
+                for (size_t j = 0; j < n * S; j++)
+                    x[j] = src[j] ^ a[j];
+
+                multi_block_encrypt_long<T, S>(in.subspan(0, n * S), dest.subspan(g * S, n * S), context);
+
+                for (size_t j = 0; j < n * S; j++)
+                    dst[j] += b[j];
+            }
+        }
+
+        template <typename T, size_t S> void multi_block_decrypt_tweaked(const span<const T>& source, const span<T>& dest, const DecryptContextShort<T, S>& context, const TweakKey& tweak, uint64_t first)
+        {
+            size_t blocks = source.size() / S, lanes = simd::Lanes<T>(), group = (lanes > 1) ? lanes : 1;
+
+            ScratchFrame scratch;
+            auto in = scratch.Take<T>(group * S);
+            T* a = scratch.Take<T>(group * S).data(), * b = scratch.Take<T>(group * S).data(), * x = in.data();
+
+            for (size_t g = 0; g < blocks; g += group)
+            {
+                size_t n = (blocks - g < group) ? blocks - g : group;
+                const T* src = source.data() + g * S;
+                T* dst = dest.data() + g * S;
+
+                for (size_t i = 0; i < n; i++)
+                    tweak.Masks<T>(first + g + i, a + i * S, b + i * S, S);
+
+                for (size_t j = 0; j < n * S; j++)
+                    x[j] = src[j] - b[j];
+
+                multi_block_decrypt_short<T, S>(in.subspan(0, n * S), dest.subspan(g * S, n * S), context);
+
+                for (size_t j = 0; j < n * S; j++)
+                    dst[j] ^= a[j];
+            }
         }
     }
 }
\ No newline at end of file
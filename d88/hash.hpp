@@ -14,12 +14,12 @@ namespace d88
         template <typename T, size_t S> class HashContextFeedback
         {
         public:
-            HashContextFeedback() :pt(S) {}
+            HashContextFeedback() :pt(GeneratePascal<T, S>()) {}
 
             const PascalTriangle<T>& Pascal() const { return pt; }
 
         private:
-            PascalTriangle<T> pt;             //TODO compile time buffers and initialization
+            PascalTriangle<T> pt;
         };
 
         template <typename T, size_t S> using HashContextLong = EncryptContextLong<T,S>;
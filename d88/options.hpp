@@ -0,0 +1,47 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "pool.hpp"
+
+namespace d88
+{
+    //Caller choices for the chunked api operations, aggregate initialised in field order.
+    //
+
+    struct options_t
+    {
+        //threads 0 uses every hardware thread and 1 runs everything on the calling thread, grain is the chunks per task, 0 for about 8 tasks per worker.
+        //
+
+        size_t threads = 0;
+        bool pin = false;
+        size_t grain = 0;
+
+        //buffer is the bytes each streaming ring slot holds, 0 for the default. direct routes files through O_DIRECT + io_uring where the platform has them.
+        //
+
+        size_t buffer = 0;
+        bool direct = false;
+
+        //profile indexes the protection profile table, parity files record theirs so it only picks the layout of new parity.
+        //tweak whitens each encrypted chunk with its index, the cipher does not record it so both sides must ask for it.
+        //
+
+        size_t profile = 0;
+        bool tweak = false;
+    };
+
+    inline ThreadPool& SharedPool(const options_t& options)
+    {
+        return SharedPool(options.threads, options.pin);
+    }
+
+    template <typename F> void ParallelFor(size_t n, const options_t& options, F&& f)
+    {
+        ParallelFor(n, options.threads, options.pin, options.grain, std::forward<F>(f));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,294 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace d88
+{
+    //Persistent pool, worker w owns a run of the task range and takes from its front, idle workers steal from the back of the others.
+    //The calling thread works as worker 0 so For() never sleeps while there is work, the worker index is stable for per worker state.
+    //
+
+    class ThreadPool
+    {
+    public:
+        ThreadPool(size_t threads = 0, bool pin = false)
+        {
+            if (!threads) threads = std::thread::hardware_concurrency();
+            if (!threads) threads = 1;
+
+            count = threads;
+            queues.reset(new queue_t[count]);
+
+            for (size_t w = 1; w < count; w++)
+            {
+                workers.emplace_back([this, w]() { Run(w); });
+
+                if (pin)
+                    Pin(workers.back(), w);
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stop = true;
+            }
+
+            wake.notify_all();
+
+            for (auto& t : workers)
+                t.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const { return count; }
+
+        //The pool the calling thread is working for, nullptr outside any task:
+        //
+
+        static ThreadPool* Current() { return current; }
+
+        //Calls f(worker, first, last) over [0, n) in ranges of grain, returns when all are done and rethrows the first exception.
+        //Nested calls from inside a task run inline on that worker.
+        //
+
+        template <typename F> void For(size_t n, size_t grain, F&& f)
+        {
+            if (!n)
+                return;
+
+            if (!grain)
+                grain = (n / (count * 8)) ? n / (count * 8) : 1;
+
+            size_t tasks = (n + grain - 1) / grain;
+
+            if (count == 1 || tasks == 1 || current == this)
+            {
+                f((current == this) ? index : 0, 0, n);
+                return;
+            }
+
+            std::lock_guard<std::mutex> submit_lock(submit);
+
+            job = [&](size_t w, size_t first, size_t last) { f(w, first, last); };
+            job_size = n;
+            job_grain = grain;
+            error = nullptr;
+            remaining = tasks;
+
+            for (size_t w = 0; w < count; w++)
+            {
+                std::lock_guard<std::mutex> lock(queues[w].m);
+
+                queues[w].head = tasks * w / count;
+                queues[w].tail = tasks * (w + 1) / count;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                generation++;
+            }
+
+            wake.notify_all();
+
+            auto outer = current;
+            auto outer_index = index;
+
+            current = this;
+            index = 0;
+
+            Work(0);
+
+            current = outer;
+            index = outer_index;
+
+            {
+                std::unique_lock<std::mutex> lock(m);
+                done.wait(lock, [&]() { return remaining.load() == 0; });
+            }
+
+            job = nullptr;
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+    private:
+        struct alignas(64) queue_t
+        {
+            std::mutex m;
+            size_t head = 0;
+            size_t tail = 0;
+        };
+
+        bool Take(size_t w, size_t& task)
+        {
+            std::lock_guard<std::mutex> lock(queues[w].m);
+
+            if (queues[w].head == queues[w].tail)
+                return false;
+
+            task = queues[w].head++;
+            return true;
+        }
+
+        bool Steal(size_t w, size_t& task)
+        {
+            for (size_t k = 1; k < count; k++)
+            {
+                auto& q = queues[(w + k) % count];
+
+                std::lock_guard<std::mutex> lock(q.m);
+
+                if (q.head != q.tail)
+                {
+                    task = --q.tail;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void Work(size_t w)
+        {
+            size_t task;
+
+            while (Take(w, task) || Steal(w, task))
+            {
+                size_t first = task * job_grain;
+                size_t last = (first + job_grain < job_size) ? first + job_grain : job_size;
+
+                try
+                {
+                    job(w, first, last);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m);
+
+                    if (!error)
+                        error = std::current_exception();
+                }
+
+                if (--remaining == 0)
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    done.notify_all();
+                }
+            }
+        }
+
+        void Run(size_t w)
+        {
+            current = this;
+            index = w;
+
+            size_t seen = 0;
+
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    wake.wait(lock, [&]() { return stop || generation != seen; });
+
+                    if (stop)
+                        return;
+
+                    seen = generation;
+                }
+
+                Work(w);
+            }
+        }
+
+        static void Pin(std::thread& t, size_t w)
+        {
+            size_t cpus = std::thread::hardware_concurrency();
+            size_t cpu = (cpus) ? w % cpus : w;
+
+#if defined(_WIN32)
+            SetThreadAffinityMask((HANDLE)t.native_handle(), (DWORD_PTR)1 << (cpu % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu % CPU_SETSIZE, &set);
+            pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#endif
+        }
+
+        size_t count = 1;
+
+        std::unique_ptr<queue_t[]> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex submit;
+        std::mutex m;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        bool stop = false;
+        size_t generation = 0;
+
+        std::function<void(size_t, size_t, size_t)> job;
+        size_t job_size = 0;
+        size_t job_grain = 1;
+        std::atomic<size_t> remaining = 0;
+        std::exception_ptr error;
+
+        static inline thread_local ThreadPool* current = nullptr;
+        static inline thread_local size_t index = 0;
+    };
+
+    //One persistent pool per (threads, pin), created on first use and kept for the life of the process. threads 0 uses every hardware thread.
+    //
+
+    inline ThreadPool& SharedPool(size_t threads = 0, bool pin = false)
+    {
+        static std::mutex m;
+        static std::map<std::pair<size_t, bool>, std::unique_ptr<ThreadPool>> pools;
+
+        if (!threads) threads = std::thread::hardware_concurrency();
+        if (!threads) threads = 1;
+
+        std::lock_guard<std::mutex> lock(m);
+
+        auto& pool = pools[std::make_pair(threads, pin)];
+        if (!pool)
+            pool.reset(new ThreadPool(threads, pin));
+
+        return *pool;
+    }
+
+    //Runs f(worker, first, last) over [0, n) in ranges of grain on the shared pool for (threads, pin).
+    //
+
+    template <typename F> void ParallelFor(size_t n, size_t threads, bool pin, size_t grain, F&& f)
+    {
+        SharedPool(threads, pin).For(n, grain, std::forward<F>(f));
+    }
+}
\ No newline at end of file
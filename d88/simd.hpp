@@ -0,0 +1,718 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define D88_SIMD_X86
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+#endif
+
+//Kernels are compiled for their own instruction set and only ever entered after cpuid says so.
+//The rest of the binary stays baseline x64 so one build runs everywhere.
+//
+
+#if defined(D88_SIMD_X86) && defined(__GNUC__)
+#define D88_TARGET_AVX2 __attribute__((target("avx2")))
+#define D88_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512dq,avx512bw")))
+#else
+#define D88_TARGET_AVX2
+#define D88_TARGET_AVX512
+#endif
+
+namespace d88
+{
+    namespace simd
+    {
+        enum class isa_t : int
+        {
+            scalar = 0,
+            avx2 = 1,
+            avx512 = 2
+        };
+
+        inline isa_t Detect()
+        {
+#if defined(D88_SIMD_X86)
+            auto cpuid = [](unsigned leaf, unsigned sub, unsigned r[4])
+            {
+#if defined(_MSC_VER)
+                __cpuidex((int*)r, (int)leaf, (int)sub);
+#else
+                __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+            };
+
+            auto xgetbv = []() -> uint64_t
+            {
+#if defined(_MSC_VER)
+                return _xgetbv(0);
+#else
+                uint32_t a, d;
+                __asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+                return ((uint64_t)d << 32) | a;
+#endif
+            };
+
+            unsigned r[4] = { 0,0,0,0 };
+
+            cpuid(0, 0, r);
+            if (r[0] < 7)
+                return isa_t::scalar;
+
+            cpuid(1, 0, r);
+            if (!(r[2] & (1u << 27))) //OSXSAVE
+                return isa_t::scalar;
+
+            uint64_t xcr0 = xgetbv();
+            if ((xcr0 & 0x6) != 0x6) //XMM|YMM state
+                return isa_t::scalar;
+
+            cpuid(7, 0, r);
+
+            bool avx2 = r[1] & (1u << 5);
+            bool avx512 = (r[1] & (1u << 16)) && (r[1] & (1u << 17)) && (r[1] & (1u << 30)); //F, DQ, BW
+
+            if (avx512 && (xcr0 & 0xE0) == 0xE0) //OPMASK|ZMM state
+                return isa_t::avx512;
+
+            if (avx2)
+                return isa_t::avx2;
+#endif
+            return isa_t::scalar;
+        }
+
+        inline const isa_t detected = Detect();
+
+        inline std::atomic<isa_t> active = detected;
+
+        //Every dispatch reads the active set once and hands it down, so a kernel always matches the lane count its caller sized buffers for.
+        //
+
+        inline isa_t Active()
+        {
+            return active.load(std::memory_order_relaxed);
+        }
+
+        //Lower the active instruction set, never raise it past what the cpu has, returns the one in use.
+        //Calls already running finish on the set they started with.
+        //
+
+        inline isa_t Select(isa_t i)
+        {
+            isa_t use = ((int)i > (int)detected) ? detected : i;
+
+            active.store(use, std::memory_order_relaxed);
+
+            return use;
+        }
+
+        template <typename T> constexpr bool supported = std::is_integral<T>::value && std::is_unsigned<T>::value && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+        template <typename T> T MulLo(T a, T b)
+        {
+            if constexpr (sizeof(T) < sizeof(unsigned))
+                return (T)((unsigned)a * (unsigned)b);
+            else
+                return a * b;
+        }
+
+        //Negate when (i + j) is odd, without a branch:
+        //
+
+        template <typename T> T Polar(T v, size_t i, size_t j)
+        {
+            T m = (T)0 - (T)((i ^ j) & 1);
+            return (T)((v ^ m) - m);
+        }
+
+#if defined(D88_SIMD_X86)
+
+        namespace avx2
+        {
+            template <typename T> D88_TARGET_AVX2 inline __m256i Mul(__m256i a, __m256i b)
+            {
+                if constexpr (sizeof(T) == 8)
+                {
+                    __m256i lo = _mm256_mul_epu32(a, b);
+                    __m256i c1 = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+                    __m256i c2 = _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32));
+
+                    return _mm256_add_epi64(lo, _mm256_slli_epi64(_mm256_add_epi64(c1, c2), 32));
+                }
+                else if constexpr (sizeof(T) == 4)
+                    return _mm256_mullo_epi32(a, b);
+                else
+                    return _mm256_mullo_epi16(a, b);
+            }
+
+            template <typename T> D88_TARGET_AVX2 inline __m256i Add(__m256i a, __m256i b)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm256_add_epi64(a, b);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm256_add_epi32(a, b);
+                else
+                    return _mm256_add_epi16(a, b);
+            }
+
+            template <typename T> D88_TARGET_AVX2 inline __m256i Sub(__m256i a, __m256i b)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm256_sub_epi64(a, b);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm256_sub_epi32(a, b);
+                else
+                    return _mm256_sub_epi16(a, b);
+            }
+
+            //Lane k of a vector starting at an even column holds column parity k % 2.
+            //sign[p] negates the lanes whose parity differs from row parity p.
+            //
+
+            template <typename T> D88_TARGET_AVX2 inline __m256i Sign(size_t p)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+                alignas(32) T m[W];
+
+                for (size_t k = 0; k < W; k++)
+                    m[k] = ((k ^ p) & 1) ? (T)~(T)0 : (T)0;
+
+                return _mm256_load_si256((const __m256i*)m);
+            }
+
+            template <typename T> D88_TARGET_AVX2 inline T Sum(__m256i v)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+                alignas(32) T l[W];
+
+                _mm256_store_si256((__m256i*)l, v);
+
+                T s = 0;
+                for (size_t k = 0; k < W; k++)
+                    s += l[k];
+
+                return s;
+            }
+
+            template <typename T> D88_TARGET_AVX2 T Dot(const T* a, const T* b, size_t n)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+
+                __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+                size_t j = 0;
+
+                for (; j + 2 * W <= n; j += 2 * W)
+                {
+                    acc0 = Add<T>(acc0, Mul<T>(_mm256_loadu_si256((const __m256i*)(a + j)), _mm256_loadu_si256((const __m256i*)(b + j))));
+                    acc1 = Add<T>(acc1, Mul<T>(_mm256_loadu_si256((const __m256i*)(a + j + W)), _mm256_loadu_si256((const __m256i*)(b + j + W))));
+                }
+
+                for (; j + W <= n; j += W)
+                    acc0 = Add<T>(acc0, Mul<T>(_mm256_loadu_si256((const __m256i*)(a + j)), _mm256_loadu_si256((const __m256i*)(b + j))));
+
+                T s = Sum<T>(Add<T>(acc0, acc1));
+
+                for (; j < n; j++)
+                    s += MulLo<T>(a[j], b[j]);
+
+                return s;
+            }
+
+            template <typename T> D88_TARGET_AVX2 void PascalRows(const T* triangle, const T* data, size_t n, T* output, size_t rows, bool polar, size_t first)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+
+                const __m256i sign[2] = { Sign<T>(0), Sign<T>(1) };
+
+                for (size_t i = rows; i-- > first;)
+                {
+                    const T* row = triangle + i * (i + 1) / 2;
+                    size_t len = (i + 1 < n) ? i + 1 : n;
+                    size_t j = 0;
+
+                    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+
+                    for (; j + 2 * W <= len; j += 2 * W)
+                    {
+                        acc0 = Add<T>(acc0, Mul<T>(_mm256_loadu_si256((const __m256i*)(row + j)), _mm256_loadu_si256((const __m256i*)(data + j))));
+                        acc1 = Add<T>(acc1, Mul<T>(_mm256_loadu_si256((const __m256i*)(row + j + W)), _mm256_loadu_si256((const __m256i*)(data + j + W))));
+                    }
+
+                    for (; j + W <= len; j += W)
+                        acc0 = Add<T>(acc0, Mul<T>(_mm256_loadu_si256((const __m256i*)(row + j)), _mm256_loadu_si256((const __m256i*)(data + j))));
+
+                    acc0 = Add<T>(acc0, acc1);
+
+                    if (polar)
+                    {
+                        __m256i m = sign[i & 1];
+                        acc0 = Sub<T>(_mm256_xor_si256(acc0, m), m);
+                    }
+
+                    T s = Sum<T>(acc0);
+
+                    for (; j < len; j++)
+                        s += (polar) ? Polar<T>(MulLo<T>(row[j], data[j]), i, j) : MulLo<T>(row[j], data[j]);
+
+                    output[i] = s;
+                }
+            }
+
+            template <typename T> D88_TARGET_AVX2 inline __m256i Broadcast(T v)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm256_set1_epi64x((long long)v);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm256_set1_epi32((int)v);
+                else
+                    return _mm256_set1_epi16((short)v);
+            }
+
+            //Lane kernels carry W independent blocks, element j of lane l lives at [j * W + l].
+            //Every coefficient is broadcast, so the serial dependence of each block runs in parallel across lanes.
+            //
+
+            template <typename T> D88_TARGET_AVX2 void PascalLanes(const T* triangle, const T* in, size_t n, T* out)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T* row = triangle + i * (i + 1) / 2;
+
+                    __m256i acc = _mm256_setzero_si256();
+
+                    for (size_t j = 0; j <= i; j++)
+                        acc = Add<T>(acc, Mul<T>(Broadcast<T>(row[j]), _mm256_loadu_si256((const __m256i*)(in + j * W))));
+
+                    _mm256_storeu_si256((__m256i*)(out + i * W), acc);
+                }
+            }
+
+            template <typename T, typename R> D88_TARGET_AVX2 void PolynomialLanes(const T* in, size_t n, T* out, const R& et)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T* r = et.Solve(i);
+
+                    __m256i acc = Mul<T>(_mm256_loadu_si256((const __m256i*)(in + ((et.inverse()) ? n - 1 - i : i) * W)), Broadcast<T>(et.Diagonal(i)));
+
+                    for (size_t p = 0; p < i; p++)
+                        acc = Sub<T>(acc, Mul<T>(Broadcast<T>(r[p]), _mm256_loadu_si256((const __m256i*)(out + p * W))));
+
+                    _mm256_storeu_si256((__m256i*)(out + i * W), acc);
+                }
+            }
+
+            template <typename T, typename R> D88_TARGET_AVX2 void FunctionLanes(const T* in, size_t n, T* out, const R& es, size_t first, size_t rows)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+
+                for (size_t k = 0; k < rows; k++)
+                {
+                    const T* c = es[first + k].data();
+
+                    __m256i acc = _mm256_setzero_si256();
+
+                    for (size_t j = 0; j < n; j++)
+                        acc = Add<T>(acc, Mul<T>(Broadcast<T>(c[n - 1 - j]), _mm256_loadu_si256((const __m256i*)(in + j * W))));
+
+                    _mm256_storeu_si256((__m256i*)(out + k * W), acc);
+                }
+            }
+
+            template <typename T> D88_TARGET_AVX2 void MulSub(T* dst, const T* src, T f, size_t n)
+            {
+                constexpr size_t W = 32 / sizeof(T);
+
+                __m256i m = Broadcast<T>(f);
+                size_t j = 0;
+
+                for (; j + W <= n; j += W)
+                    _mm256_storeu_si256((__m256i*)(dst + j), Sub<T>(_mm256_loadu_si256((const __m256i*)(dst + j)), Mul<T>(m, _mm256_loadu_si256((const __m256i*)(src + j)))));
+
+                for (; j < n; j++)
+                    dst[j] -= MulLo<T>(f, src[j]);
+            }
+        }
+
+        namespace avx512
+        {
+            template <typename T> D88_TARGET_AVX512 inline __m512i Mul(__m512i a, __m512i b)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm512_mullo_epi64(a, b);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm512_mullo_epi32(a, b);
+                else
+                    return _mm512_mullo_epi16(a, b);
+            }
+
+            template <typename T> D88_TARGET_AVX512 inline __m512i Add(__m512i a, __m512i b)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm512_add_epi64(a, b);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm512_add_epi32(a, b);
+                else
+                    return _mm512_add_epi16(a, b);
+            }
+
+            template <typename T> D88_TARGET_AVX512 inline __m512i Sub(__m512i a, __m512i b)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm512_sub_epi64(a, b);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm512_sub_epi32(a, b);
+                else
+                    return _mm512_sub_epi16(a, b);
+            }
+
+            template <typename T> D88_TARGET_AVX512 inline __m512i Load(const T* p, size_t count)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm512_maskz_loadu_epi64((__mmask8)((count >= 8) ? 0xFF : ((1u << count) - 1)), p);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm512_maskz_loadu_epi32((__mmask16)((count >= 16) ? 0xFFFF : ((1u << count) - 1)), p);
+                else
+                    return _mm512_maskz_loadu_epi16((__mmask32)((count >= 32) ? 0xFFFFFFFFu : ((1u << count) - 1)), p);
+            }
+
+            template <typename T> D88_TARGET_AVX512 inline __m512i Sign(size_t p)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+                alignas(64) T m[W];
+
+                for (size_t k = 0; k < W; k++)
+                    m[k] = ((k ^ p) & 1) ? (T)~(T)0 : (T)0;
+
+                return _mm512_load_si512((const void*)m);
+            }
+
+            template <typename T> D88_TARGET_AVX512 inline T Sum(__m512i v)
+            {
+                //Fold the two 256 bit halves and finish with the AVX2 reduction.
+                //The zero masked extracts keep GCC 12 from warning about the undefined register the reduce and cast intrinsics start from.
+                //
+
+                if constexpr (sizeof(T) == 8)
+                    return avx2::Sum<T>(_mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xFF, v, 0), _mm512_maskz_extracti64x4_epi64(0xFF, v, 1)));
+                else if constexpr (sizeof(T) == 4)
+                    return avx2::Sum<T>(_mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xFF, v, 0), _mm512_maskz_extracti64x4_epi64(0xFF, v, 1)));
+                else
+                {
+                    alignas(64) T l[32];
+
+                    _mm512_store_si512((void*)l, v);
+
+                    T s = 0;
+                    for (size_t k = 0; k < 32; k++)
+                        s += l[k];
+
+                    return s;
+                }
+            }
+
+            template <typename T> D88_TARGET_AVX512 T Dot(const T* a, const T* b, size_t n)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+
+                __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+                size_t j = 0;
+
+                for (; j + 2 * W <= n; j += 2 * W)
+                {
+                    acc0 = Add<T>(acc0, Mul<T>(_mm512_loadu_si512((const void*)(a + j)), _mm512_loadu_si512((const void*)(b + j))));
+                    acc1 = Add<T>(acc1, Mul<T>(_mm512_loadu_si512((const void*)(a + j + W)), _mm512_loadu_si512((const void*)(b + j + W))));
+                }
+
+                for (; j < n; j += W)
+                    acc0 = Add<T>(acc0, Mul<T>(Load<T>(a + j, n - j), Load<T>(b + j, n - j)));
+
+                return Sum<T>(Add<T>(acc0, acc1));
+            }
+
+            //Masked loads take the row tail, so there is no scalar remainder loop.
+            //
+
+            template <typename T> D88_TARGET_AVX512 void PascalRows(const T* triangle, const T* data, size_t n, T* output, size_t rows, bool polar, size_t first)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+
+                const __m512i sign[2] = { Sign<T>(0), Sign<T>(1) };
+
+                for (size_t i = rows; i-- > first;)
+                {
+                    const T* row = triangle + i * (i + 1) / 2;
+                    size_t len = (i + 1 < n) ? i + 1 : n;
+                    size_t j = 0;
+
+                    __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+
+                    for (; j + 2 * W <= len; j += 2 * W)
+                    {
+                        acc0 = Add<T>(acc0, Mul<T>(_mm512_loadu_si512((const void*)(row + j)), _mm512_loadu_si512((const void*)(data + j))));
+                        acc1 = Add<T>(acc1, Mul<T>(_mm512_loadu_si512((const void*)(row + j + W)), _mm512_loadu_si512((const void*)(data + j + W))));
+                    }
+
+                    for (; j < len; j += W)
+                        acc0 = Add<T>(acc0, Mul<T>(Load<T>(row + j, len - j), Load<T>(data + j, len - j)));
+
+                    acc0 = Add<T>(acc0, acc1);
+
+                    if (polar)
+                    {
+                        __m512i m = sign[i & 1];
+                        acc0 = Sub<T>(_mm512_xor_si512(acc0, m), m);
+                    }
+
+                    output[i] = Sum<T>(acc0);
+                }
+            }
+
+            template <typename T> D88_TARGET_AVX512 inline __m512i Broadcast(T v)
+            {
+                if constexpr (sizeof(T) == 8)
+                    return _mm512_set1_epi64((long long)v);
+                else if constexpr (sizeof(T) == 4)
+                    return _mm512_set1_epi32((int)v);
+                else
+                    return _mm512_set1_epi16((short)v);
+            }
+
+            template <typename T> D88_TARGET_AVX512 void PascalLanes(const T* triangle, const T* in, size_t n, T* out)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T* row = triangle + i * (i + 1) / 2;
+
+                    __m512i acc = _mm512_setzero_si512();
+
+                    for (size_t j = 0; j <= i; j++)
+                        acc = Add<T>(acc, Mul<T>(Broadcast<T>(row[j]), _mm512_loadu_si512((const void*)(in + j * W))));
+
+                    _mm512_storeu_si512((void*)(out + i * W), acc);
+                }
+            }
+
+            template <typename T, typename R> D88_TARGET_AVX512 void PolynomialLanes(const T* in, size_t n, T* out, const R& et)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+
+                for (size_t i = 0; i < n; i++)
+                {
+                    const T* r = et.Solve(i);
+
+                    __m512i acc = Mul<T>(_mm512_loadu_si512((const void*)(in + ((et.inverse()) ? n - 1 - i : i) * W)), Broadcast<T>(et.Diagonal(i)));
+
+                    for (size_t p = 0; p < i; p++)
+                        acc = Sub<T>(acc, Mul<T>(Broadcast<T>(r[p]), _mm512_loadu_si512((const void*)(out + p * W))));
+
+                    _mm512_storeu_si512((void*)(out + i * W), acc);
+                }
+            }
+
+            template <typename T, typename R> D88_TARGET_AVX512 void FunctionLanes(const T* in, size_t n, T* out, const R& es, size_t first, size_t rows)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+
+                for (size_t k = 0; k < rows; k++)
+                {
+                    const T* c = es[first + k].data();
+
+                    __m512i acc = _mm512_setzero_si512();
+
+                    for (size_t j = 0; j < n; j++)
+                        acc = Add<T>(acc, Mul<T>(Broadcast<T>(c[n - 1 - j]), _mm512_loadu_si512((const void*)(in + j * W))));
+
+                    _mm512_storeu_si512((void*)(out + k * W), acc);
+                }
+            }
+
+            template <typename T> D88_TARGET_AVX512 void MulSub(T* dst, const T* src, T f, size_t n)
+            {
+                constexpr size_t W = 64 / sizeof(T);
+
+                __m512i m = Broadcast<T>(f);
+                size_t j = 0;
+
+                for (; j + W <= n; j += W)
+                    _mm512_storeu_si512((void*)(dst + j), Sub<T>(_mm512_loadu_si512((const void*)(dst + j)), Mul<T>(m, _mm512_loadu_si512((const void*)(src + j)))));
+
+                for (; j < n; j++)
+                    dst[j] -= MulLo<T>(f, src[j]);
+            }
+        }
+
+#endif
+
+        //output[i] = sum triangle row i * data, j <= i and j < n, signed by (i + j) parity when polar, for rows [first, rows).
+        //Rows are produced last to first so data may alias output.
+        //Returns false when no vector unit is active and the caller should run its scalar loop.
+        //
+
+        template <typename T> bool PascalRows(const T* triangle, const T* data, size_t n, T* output, size_t rows, bool polar = false, size_t first = 0, isa_t isa = Active())
+        {
+            static_assert(supported<T>, "simd::PascalRows requires uint16_t, uint32_t or uint64_t");
+
+#if defined(D88_SIMD_X86)
+            switch (isa)
+            {
+            case isa_t::avx512:
+                avx512::PascalRows<T>(triangle, data, n, output, rows, polar, first);
+                return true;
+            case isa_t::avx2:
+                avx2::PascalRows<T>(triangle, data, n, output, rows, polar, first);
+                return true;
+            default:
+                break;
+            }
+#endif
+            return false;
+        }
+
+        //sum a[j] * b[j] mod 2^w, short runs stay scalar.
+        //
+
+        template <typename T> T Dot(const T* a, const T* b, size_t n)
+        {
+            static_assert(supported<T>, "simd::Dot requires uint16_t, uint32_t or uint64_t");
+
+#if defined(D88_SIMD_X86)
+            if (n >= 64 / sizeof(T))
+            {
+                switch (Active())
+                {
+                case isa_t::avx512:
+                    return avx512::Dot<T>(a, b, n);
+                case isa_t::avx2:
+                    return avx2::Dot<T>(a, b, n);
+                default:
+                    break;
+                }
+            }
+#endif
+            T s = 0;
+            for (size_t j = 0; j < n; j++)
+                s += MulLo<T>(a[j], b[j]);
+
+            return s;
+        }
+
+        //dst[j] -= f * src[j] mod 2^w, the row update of every elimination. Short rows stay scalar.
+        //
+
+        template <typename T> void MulSub(T* dst, const T* src, T f, size_t n)
+        {
+            static_assert(supported<T>, "simd::MulSub requires uint16_t, uint32_t or uint64_t");
+
+#if defined(D88_SIMD_X86)
+            if (n >= 64 / sizeof(T))
+            {
+                switch (Active())
+                {
+                case isa_t::avx512:
+                    avx512::MulSub<T>(dst, src, f, n);
+                    return;
+                case isa_t::avx2:
+                    avx2::MulSub<T>(dst, src, f, n);
+                    return;
+                default:
+                    break;
+                }
+            }
+#endif
+            for (size_t j = 0; j < n; j++)
+                dst[j] -= MulLo<T>(f, src[j]);
+        }
+
+        //Blocks a lane kernel carries at once under the active instruction set, 0 when scalar.
+        //
+
+        template <typename T> size_t Lanes(isa_t isa = Active())
+        {
+#if defined(D88_SIMD_X86)
+            if constexpr (supported<T>)
+            {
+                switch (isa)
+                {
+                case isa_t::avx512:
+                    return 64 / sizeof(T);
+                case isa_t::avx2:
+                    return 32 / sizeof(T);
+                default:
+                    break;
+                }
+            }
+#endif
+            return 0;
+        }
+
+        //Transpose lanes consecutive blocks of n into lane order and back.
+        //
+
+        template <typename T> void Interleave(const T* blocks, size_t n, size_t lanes, T* out)
+        {
+            for (size_t l = 0; l < lanes; l++)
+                for (size_t j = 0; j < n; j++)
+                    out[j * lanes + l] = blocks[l * n + j];
+        }
+
+        template <typename T> void Deinterleave(const T* in, size_t n, size_t lanes, T* blocks)
+        {
+            for (size_t l = 0; l < lanes; l++)
+                for (size_t j = 0; j < n; j++)
+                    blocks[l * n + j] = in[j * lanes + l];
+        }
+
+        //Lane forms of ToPascal, ToPolynomial and ToFunction over Lanes<T>(isa) interleaved blocks.
+        //Only call these when Lanes<T>(isa) is non zero, with the same isa the buffers were sized for.
+        //
+
+        template <typename T> void PascalLanes(isa_t isa, const T* triangle, const T* in, size_t n, T* out)
+        {
+#if defined(D88_SIMD_X86)
+            if (isa == isa_t::avx512)
+                avx512::PascalLanes<T>(triangle, in, n, out);
+            else
+                avx2::PascalLanes<T>(triangle, in, n, out);
+#endif
+        }
+
+        template <typename T, typename R> void PolynomialLanes(isa_t isa, const T* in, size_t n, T* out, const R& et)
+        {
+#if defined(D88_SIMD_X86)
+            if (isa == isa_t::avx512)
+                avx512::PolynomialLanes<T>(in, n, out, et);
+            else
+                avx2::PolynomialLanes<T>(in, n, out, et);
+#endif
+        }
+
+        template <typename T, typename R> void FunctionLanes(isa_t isa, const T* in, size_t n, T* out, const R& es, size_t first, size_t rows)
+        {
+#if defined(D88_SIMD_X86)
+            if (isa == isa_t::avx512)
+                avx512::FunctionLanes<T>(in, n, out, es, first, rows);
+            else
+                avx2::FunctionLanes<T>(in, n, out, es, first, rows);
+#endif
+        }
+    }
+}
\ No newline at end of file
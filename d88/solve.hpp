@@ -0,0 +1,195 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "base.hpp"
+#include "simd.hpp"
+
+namespace d88
+{
+    //Dense linear algebra over Z/2^w. A matrix is invertible exactly when it is invertible mod 2, so every pivot is chosen odd
+    //and the only inverses taken are of the n pivots. Matrices are row major n x n in one contiguous buffer.
+    //
+
+    template <typename T> void RowMulSub(T* dst, const T* src, T f, size_t n)
+    {
+        if constexpr (simd::supported<T>)
+            simd::MulSub<T>(dst, src, f, n);
+        else
+            for (size_t j = 0; j < n; j++)
+                dst[j] -= src[j] * f;
+    }
+
+    //Panel width and trailing column tile of the blocked update, a panel of U rows times a tile stays in L1 while every row below streams past it.
+    //
+
+    constexpr size_t lu_panel = 32;
+    constexpr size_t lu_tile = 128;
+
+    //Factors a in place into P a = L U, L unit lower and U upper. perm[i] is the source row of row i and dinv[i] the inverse of U's pivot i.
+    //Returns false when a is singular mod 2, a is then left partly factored.
+    //
+
+    template <typename T> bool FactorLU(span<T> a, size_t n, span<size_t> perm, span<T> dinv)
+    {
+        auto row = [&](size_t r) { return a.data() + r * n; };
+
+        for (size_t i = 0; i < n; i++)
+            perm[i] = i;
+
+        for (size_t k0 = 0; k0 < n; k0 += lu_panel)
+        {
+            size_t k1 = std::min(n, k0 + lu_panel);
+
+            //Factor the panel columns over every remaining row:
+            //
+
+            for (size_t c = k0; c < k1; c++)
+            {
+                size_t p = c;
+                while (p < n && row(p)[c] % 2 == 0) p++;
+
+                if (p == n)
+                    return false;
+
+                if (p != c)
+                {
+                    std::swap_ranges(row(p), row(p) + n, row(c));
+                    std::swap(perm[p], perm[c]);
+                }
+
+                dinv[c] = GetInverse<T>(row(c)[c]);
+
+                for (size_t r = c + 1; r < n; r++)
+                {
+                    T f = row(r)[c] * dinv[c];
+                    row(r)[c] = f;
+
+                    if (f != 0)
+                        RowMulSub<T>(row(r) + c + 1, row(c) + c + 1, f, k1 - c - 1);
+                }
+            }
+
+            if (k1 == n)
+                break;
+
+            //U12, the panel rows right of the panel, by forward substitution with L11:
+            //
+
+            for (size_t c = k0; c < k1; c++)
+                for (size_t r = c + 1; r < k1; r++)
+                    if (row(r)[c] != 0)
+                        RowMulSub<T>(row(r) + k1, row(c) + k1, row(r)[c], n - k1);
+
+            //A22 -= L21 U12, one column tile at a time:
+            //
+
+            for (size_t j0 = k1; j0 < n; j0 += lu_tile)
+            {
+                size_t j1 = std::min(n, j0 + lu_tile);
+
+                for (size_t r = k1; r < n; r++)
+                    for (size_t c = k0; c < k1; c++)
+                        if (row(r)[c] != 0)
+                            RowMulSub<T>(row(r) + j0, row(c) + j0, row(r)[c], j1 - j0);
+            }
+        }
+
+        return true;
+    }
+
+    //Solves a x = b in place in b with the factors of FactorLU, one right hand side per call so the factors are reused.
+    //
+
+    template <typename T> void SolveLU(span<const T> a, size_t n, span<const size_t> perm, span<const T> dinv, span<T> b, span<T> scratch)
+    {
+        for (size_t i = 0; i < n; i++)
+            scratch[i] = b[perm[i]];
+
+        for (size_t r = 0; r < n; r++)
+        {
+            const T* l = a.data() + r * n;
+
+            for (size_t k = 0; k < r; k++)
+                scratch[r] -= l[k] * scratch[k];
+        }
+
+        for (size_t r = n; r-- > 0;)
+        {
+            const T* u = a.data() + r * n;
+
+            for (size_t k = r + 1; k < n; k++)
+                scratch[r] -= u[k] * scratch[k];
+
+            scratch[r] *= dinv[r];
+        }
+
+        std::copy(scratch.begin(), scratch.begin() + n, b.begin());
+    }
+
+    //Owning form for factors that outlive one solve, such as the per window inverses of a repair plan.
+    //
+
+    template <typename T> class DenseLU
+    {
+    public:
+        DenseLU() {}
+
+        DenseLU(const T* m, size_t size, size_t stride) { Factor(m, size, stride); }
+
+        bool Factor(const T* m, size_t size, size_t stride)
+        {
+            n = size;
+            lu.resize(n * n);
+            perm.resize(n);
+            dinv.resize(n);
+            work.resize(n);
+
+            for (size_t r = 0; r < n; r++)
+                std::copy(m + r * stride, m + r * stride + n, lu.begin() + r * n);
+
+            ready = FactorLU<T>(lu, n, perm, dinv);
+
+            return ready;
+        }
+
+        bool Ready() const { return ready; }
+        size_t size() const { return n; }
+
+        void Solve(T* b)
+        {
+            SolveLU<T>(lu, n, perm, dinv, span<T>(b, n), work);
+        }
+
+        //Row major inverse, column j is the solution against unit vector j:
+        //
+
+        void Inverse(T* out)
+        {
+            std::vector<T> e(n);
+
+            for (size_t j = 0; j < n; j++)
+            {
+                std::fill(e.begin(), e.end(), T(0));
+                e[j] = 1;
+
+                Solve(e.data());
+
+                for (size_t i = 0; i < n; i++)
+                    out[i * n + j] = e[i];
+            }
+        }
+
+    private:
+        size_t n = 0;
+        bool ready = false;
+
+        std::vector<T> lu;
+        std::vector<size_t> perm;
+        std::vector<T> dinv;
+        std::vector<T> work;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+/* Copyright (C) 2020 D8DATAWORKS - All Rights Reserved */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace d88
+{
+    //Sequential byte source or sink, Read returns a short count only at the end of the stream and Flush finishes a written stream.
+    //
+
+    class stream_io
+    {
+    public:
+        virtual ~stream_io() {}
+
+        virtual size_t Read(uint8_t* p, size_t n) = 0;
+        virtual void Write(const uint8_t* p, size_t n) = 0;
+        virtual void Flush() = 0;
+    };
+
+    //Buffered stdio stream over a file, "-" reads stdin or writes stdout.
+    //
+
+    class stream_file : public stream_io
+    {
+    public:
+        stream_file(std::string_view path, bool write)
+        {
+            if (path == "-")
+            {
+                f = (write) ? stdout : stdin;
+                owned = false;
+
+#if defined(_WIN32)
+                _setmode(_fileno(f), _O_BINARY);
+#endif
+            }
+            else
+                f = std::fopen(std::string(path).c_str(), (write) ? "wb" : "rb");
+
+            if (!f)
+                throw "Unable to open stream.";
+        }
+
+        ~stream_file()
+        {
+            if (owned)
+                std::fclose(f);
+            else
+                std::fflush(f);
+        }
+
+        stream_file(const stream_file&) = delete;
+        stream_file& operator=(const stream_file&) = delete;
+
+        size_t Read(uint8_t* p, size_t n) override
+        {
+            size_t total = 0;
+
+            while (total < n)
+            {
+                size_t got = std::fread(p + total, 1, n - total, f);
+
+                if (!got)
+                {
+                    if (std::ferror(f))
+                        throw "Stream read error.";
+
+                    break;
+                }
+
+                total += got;
+            }
+
+            return total;
+        }
+
+        void Write(const uint8_t* p, size_t n) override
+        {
+            if (n && std::fwrite(p, 1, n, f) != n)
+                throw "Stream write error.";
+        }
+
+        void Flush() override
+        {
+            if (std::fflush(f))
+                throw "Stream write error.";
+        }
+
+    private:
+        std::FILE* f = nullptr;
+        bool owned = true;
+    };
+
+    //One ring entry, in holds what the reader took from the stream and out what the writer will emit.
+    //
+
+    struct stream_slot_t
+    {
+        std::vector<uint8_t> in, out;
+
+        size_t size = 0;
+        size_t out_size = 0;
+        size_t offset = 0;
+        bool last = false;
+    };
+
+    //Three stage pipeline over a fixed ring of slots, a reader thread fills them in order, the calling thread transforms each one
+    //(fanning out to the pool inside transform) and a writer thread drains them in order. Memory is the ring, whatever the stream length.
+    //read(slot) returns false once the slot it filled is the last one. The first exception from any stage stops all three and is rethrown.
+    //
+
+    template <typename R, typename F, typename W> void StreamPipeline(std::vector<stream_slot_t>& ring, R read, F transform, W write)
+    {
+        std::mutex m;
+        std::condition_variable cv;
+
+        size_t filled = 0, transformed = 0, written = 0;
+        bool read_done = false, failed = false;
+        std::exception_ptr error;
+
+        auto fail = [&]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+
+                if (!error)
+                    error = std::current_exception();
+
+                failed = true;
+            }
+
+            cv.notify_all();
+        };
+
+        auto advance = [&](size_t& counter, bool done = false)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m);
+
+                counter++;
+                read_done |= done;
+            }
+
+            cv.notify_all();
+        };
+
+        std::thread reader([&]()
+        {
+            try
+            {
+                for (size_t seq = 0;; seq++)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(m);
+                        cv.wait(lock, [&]() { return failed || seq - written < ring.size(); });
+
+                        if (failed)
+                            return;
+                    }
+
+                    auto& slot = ring[seq % ring.size()];
+                    slot.last = !read(slot);
+
+                    advance(filled, slot.last);
+
+                    if (slot.last)
+                        return;
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+        });
+
+        std::thread writer([&]()
+        {
+            try
+            {
+                for (size_t seq = 0;; seq++)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(m);
+                        cv.wait(lock, [&]() { return failed || transformed > seq || (read_done && seq == filled); });
+
+                        if (failed || transformed == seq)
+                            return;
+                    }
+
+                    write(ring[seq % ring.size()]);
+
+                    advance(written);
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+        });
+
+        try
+        {
+            for (size_t seq = 0;; seq++)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv.wait(lock, [&]() { return failed || filled > seq || read_done; });
+
+                    if (failed || filled == seq)
+                        break;
+                }
+
+                transform(ring[seq % ring.size()]);
+
+                advance(transformed);
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+
+        reader.join();
+        writer.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
\ No newline at end of file
@@ -5,6 +5,10 @@
 #include <vector>
 #include <utility>
 #include <filesystem>
+#include <numeric>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 
 #include "../catch.hpp"
 #include "../num.hpp"
@@ -16,6 +20,7 @@
 #include "factor.hpp"
 #include "analysis.hpp"
 #include "api.hpp"
+#include "cli.hpp"
 
 #include "../plusaes.hpp"
 #include "scalar_t/int.hpp"
@@ -27,6 +32,71 @@ using namespace d88::correct;
 using namespace d88::analysis;
 using namespace d88::api;
 
+//Counts every global allocation so a test can show a path stays off the heap:
+//
+
+static std::atomic<size_t> heap_allocations = 0;
+
+//Every replaced new and delete goes through this one pair, aligned blocks come from the aligned family and go back to it.
+//The deletes stay out of line under GCC, otherwise it inlines the free into callers whose pointer came from operator new and reports a mismatch.
+//
+
+#if defined(__GNUC__)
+#define D88_COUNTED_DELETE __attribute__((noinline))
+#else
+#define D88_COUNTED_DELETE
+#endif
+
+static void* CountedAlloc(std::size_t n, std::size_t align = 0)
+{
+    heap_allocations++;
+
+    void* p = nullptr;
+
+    if (!align)
+        p = std::malloc(n ? n : 1);
+    else
+    {
+        size_t bytes = (n + align - 1) / align * align;
+
+#if defined(_WIN32)
+        p = _aligned_malloc(bytes ? bytes : align, align);
+#else
+        p = std::aligned_alloc(align, bytes ? bytes : align);
+#endif
+    }
+
+    if (!p)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+static void CountedFree(void* p, bool aligned = false) noexcept
+{
+#if defined(_WIN32)
+    if (aligned)
+        return _aligned_free(p);
+#endif
+
+    std::free(p);
+}
+
+void* operator new(std::size_t n) { return CountedAlloc(n); }
+void* operator new(std::size_t n, std::align_val_t a) { return CountedAlloc(n, (size_t)a); }
+
+D88_COUNTED_DELETE void operator delete(void* p) noexcept { CountedFree(p); }
+D88_COUNTED_DELETE void operator delete(void* p, std::size_t) noexcept { CountedFree(p); }
+D88_COUNTED_DELETE void operator delete(void* p, std::align_val_t) noexcept { CountedFree(p, true); }
+D88_COUNTED_DELETE void operator delete(void* p, std::size_t, std::align_val_t) noexcept { CountedFree(p, true); }
+
+template <typename F> size_t CountAllocations(F f)
+{
+    size_t before = heap_allocations;
+    f();
+    return heap_allocations - before;
+}
+
 
 TEST_CASE("extended gcd", "[d88::uintv_t]")
 {
@@ -45,6 +115,45 @@ TEST_CASE("num.hpp division", "[d88::uintv_t]")
     n /= k;
 }
 
+TEST_CASE("pascal triangle packed rows", "[d88::]")
+{
+    typedef unsigned long long T;
+
+    PascalTriangle<T> pt(64);
+
+    REQUIRE(pt.size() == 64);
+    REQUIRE(pt[0].size() == 1);
+    REQUIRE(pt[0][0] == 1);
+
+    for (size_t i = 1; i < pt.size(); i++)
+    {
+        REQUIRE(pt[i].size() == i + 1);
+        REQUIRE(pt.Row(i) == pt.Row(i - 1) + i);
+        REQUIRE(pt[i][0] == 1);
+        REQUIRE(pt[i][i] == 1);
+
+        for (size_t j = 1; j < i; j++)
+            REQUIRE(pt[i][j] == pt[i - 1][j - 1] + pt[i - 1][j]);
+    }
+}
+
+TEST_CASE("pascal triangle compile time rows", "[d88::]")
+{
+    typedef unsigned long long T;
+    constexpr size_t S = 128;
+
+    static_assert(PascalTriangle<T, S>::rows[PascalOffset(S - 1)] == 1);
+    static_assert(PascalTriangle<T, S>::rows[PascalOffset(4) + 2] == 6);
+
+    PascalTriangle<T> runtime(S);
+    auto fixed = GeneratePascal<T, S>();
+
+    REQUIRE(fixed.Row(0) == PascalTriangle<T, S>::rows.data());
+
+    for (size_t i = 0; i < S; i++)
+        REQUIRE(true == equal(runtime[i].begin(), runtime[i].end(), fixed[i].begin()));
+}
+
 TEST_CASE("encrypt_long and decrypt_short pair with uintv_t", "[d88::uintv_t]")
 {
     using U = scalar_t::uintv_t<uint8_t, 8>;
@@ -132,6 +241,116 @@ TEST_CASE("api encrypt/decrypt", "[d88::api]")
 }
 
 
+TEST_CASE("thread pool covers every index once", "[d88::pool]")
+{
+    ThreadPool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    for (size_t grain : { 0, 1, 7, 1000 })
+    {
+        std::vector<std::atomic<size_t>> hits(1000);
+        std::vector<size_t> per_worker(pool.size());
+
+        std::atomic<bool> bad_worker = false;
+
+        pool.For(hits.size(), grain, [&](size_t w, size_t first, size_t last)
+        {
+            if (w >= pool.size())
+                bad_worker = true;
+
+            for (size_t i = first; i < last; i++)
+                hits[i]++;
+
+            per_worker[w] += last - first;
+        });
+
+        REQUIRE(!bad_worker);
+
+        for (auto& h : hits)
+            REQUIRE(h == 1);
+
+        REQUIRE(std::accumulate(per_worker.begin(), per_worker.end(), (size_t)0) == hits.size());
+    }
+
+    //Nested calls run inline on the worker that made them:
+    //
+
+    std::atomic<size_t> nested = 0;
+    std::atomic<bool> moved = false;
+
+    pool.For(8, 1, [&](size_t w, size_t, size_t)
+    {
+        pool.For(10, 1, [&](size_t w2, size_t a, size_t b)
+        {
+            if (w2 != w)
+                moved = true;
+
+            nested += b - a;
+        });
+    });
+
+    REQUIRE(nested == 80);
+    REQUIRE(!moved);
+
+    REQUIRE_THROWS(pool.For(100, 1, [&](size_t, size_t first, size_t)
+    {
+        if (first == 50)
+            throw std::runtime_error("task");
+    }));
+}
+
+TEST_CASE("context cache shares, counts and evicts", "[d88::api]")
+{
+    typedef uint64_t T;
+    constexpr size_t S = 64;
+    typedef EncryptContextLong<T, S> E;
+    typedef DecryptContextShort<T, S> D;
+
+    auto sym = StringAsSymmetry<T, S>("KEY1");
+    size_t e_bytes = E(sym).Footprint(), d_bytes = D(sym).Footprint();
+
+    //The decrypt context carries the S*S symmetry, the long encrypt context only O(S) terms over the shared static triangle:
+    REQUIRE(d_bytes >= S * S * sizeof(T));
+    REQUIRE(e_bytes < d_bytes);
+
+    context_cache cache(e_bytes + d_bytes);
+
+    auto a = cache.Get<E, T, S>("KEY1");
+    auto b = cache.Get<E, T, S>("KEY1");
+    auto c = cache.Get<D, T, S>("KEY1");
+
+    REQUIRE(a == b);
+    REQUIRE((void*)a.get() != (void*)c.get());
+
+    auto stats = cache.Stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.entries == 2);
+    REQUIRE(stats.evictions == 0);
+    REQUIRE(stats.bytes == e_bytes + d_bytes);
+
+    //KEY1 encrypt was used last, so the decrypt context is the one dropped:
+    cache.Get<E, T, S>("KEY1");
+    cache.Get<E, T, S>("KEY2");
+
+    stats = cache.Stats();
+    REQUIRE(stats.entries == 2);
+    REQUIRE(stats.evictions == 1);
+    REQUIRE(stats.bytes == 2 * e_bytes);
+    REQUIRE(cache.Get<E, T, S>("KEY1") == a);
+
+    auto plain = d8u::random::Vector<T>(S);
+    std::vector<T> temp(S), enc(S), dec(S);
+
+    block_encrypt_long<T, S>(plain, temp, enc, *cache.Get<E, T, S>("KEY2"));
+    block_decrypt_short<T, S>(enc, dec, *cache.Get<D, T, S>("KEY2"));
+
+    REQUIRE_THAT(plain, Catch::Matchers::Equals(dec));
+
+    cache.Budget(0);
+    REQUIRE(cache.Stats().entries == 0);
+}
+
 TEST_CASE("api static/forward/reverse", "[d88::api]")
 {
     std::filesystem::remove_all("testdata/static");
@@ -143,7 +362,7 @@ TEST_CASE("api static/forward/reverse", "[d88::api]")
 
     generate_static("testdata/aligned_file", "testdata/after", "testdata/static");
 
-    forward_static("testdata/aligned_file", "testdata/static", "testdata/forward",false);
+    forward_static("testdata/aligned_file", "testdata/static", "testdata/forward", options_t{ 1 });
 
     {
         mio::mmap_source before("testdata/forward");
@@ -201,7 +420,6 @@ TEST_CASE("api protect/recover", "[d88::api]")
     std::filesystem::remove_all("testdata/edit");
 }
 
-
 TEST_CASE("aes reverse", "[d88::]")
 {
     constexpr size_t S = 16;
@@ -274,6 +492,114 @@ TEST_CASE("static analysis random", "[d88::]")
 }
 
 
+TEST_CASE("blocked polynomial solve matches substitution", "[d88::encrypt]")
+{
+    typedef unsigned long long T;
+    constexpr size_t S = 600;
+
+    for (bool unit : { false, true })
+    {
+        auto sym = d8u::random::Vector<T>(S);
+        if (unit) sym[0] = 0;
+
+        ElectiveTransform<T> et(sym);
+        auto pascal = d8u::random::Vector<T>(S);
+        std::vector<T> expect(S), result(S);
+
+        for (size_t i = 0; i < S; i++)
+        {
+            if (et.inverse())
+            {
+                expect[i] = pascal[S - 1 - i] * et.inverse();
+                for (size_t j = i, p = 0; j > 0; j--, p++)
+                    expect[i] -= et[i][j] * expect[p] * et.inverse();
+            }
+            else
+            {
+                expect[i] = pascal[i];
+                for (size_t j = i; j > 0; j--)
+                    expect[i] -= et[i][j] * expect[j];
+            }
+        }
+
+        ToPolynomial<T>(pascal, result, et);
+
+        if (unit)
+            REQUIRE(et.inverse() == 0);
+
+        REQUIRE_THAT(expect, Catch::Matchers::Equals(result));
+    }
+}
+
+TEST_CASE("parallel block kernels match serial", "[d88::encrypt]")
+{
+    typedef unsigned long long T;
+    constexpr size_t S = 1100;
+
+    auto cut = BalancedRows(S, 1, 1, 4);
+    REQUIRE(cut.size() == 5);
+    REQUIRE(cut.front() == 0);
+    REQUIRE(cut.back() == S);
+
+    for (size_t k = 1; k < cut.size(); k++)
+    {
+        double work = ((double)cut[k] * (cut[k] + 1) - (double)cut[k - 1] * (cut[k - 1] + 1)) / 2;
+        REQUIRE(work > 0.23 * S * (S + 1) / 2);
+        REQUIRE(work < 0.27 * S * (S + 1) / 2);
+    }
+
+    auto data = d8u::random::Vector<T>(S);
+    auto sym = d8u::random::Vector<T>(S);
+
+    PascalTriangle<T> pt(S);
+    ElectiveTransform<T> et(sym);
+    ElectiveSymmetry<T> es(sym);
+
+    std::vector<T> expect(S), result(S);
+
+    ToPascal<T>(data, expect, pt);
+    ToPascalParallel<T>(data, result, pt);
+    REQUIRE_THAT(expect, Catch::Matchers::Equals(result));
+
+    ToPolynomial<T>(data, expect, et);
+    ToPolynomial<T>(data, result, et, true);
+    REQUIRE_THAT(expect, Catch::Matchers::Equals(result));
+
+    ToFunction<T>(data, expect, es);
+    ToFunction<T>(data, result, es, true);
+    REQUIRE_THAT(expect, Catch::Matchers::Equals(result));
+
+    ToFunctionR<T>(data, expect, es);
+    ToFunctionR<T>(data, result, es, 0, true);
+    REQUIRE_THAT(expect, Catch::Matchers::Equals(result));
+}
+
+TEST_CASE("elective symmetry stores only trailing rows", "[d88::encrypt]")
+{
+    typedef unsigned long long T;
+    constexpr size_t S = 64;
+
+    auto sym = d8u::random::Vector<T>(S);
+
+    ElectiveSymmetry<T> full(sym, S * 2);
+    ElectiveSymmetry<T> trimmed(sym, S * 2, S);
+
+    REQUIRE(trimmed.size() == full.size());
+    REQUIRE(trimmed.first() == S);
+
+    for (size_t i = S; i < S * 2; i++)
+    {
+        REQUIRE(trimmed[i].size() == S);
+
+        for (size_t j = 0; j < S; j++)
+            REQUIRE(trimmed[i][j] == full[i][j]);
+    }
+
+    for (size_t i = 1; i < S * 2; i++)
+        for (size_t j = 1; j < S; j++)
+            REQUIRE(full[i][j] == full[i - 1][j - 1] - full[i - 1][j]);
+}
+
 TEST_CASE("encrypt_long and decrypt_short pair works", "[d88::encrypt]") 
 {
     auto plain = d8u::random::Vector<unsigned long long>(64);
@@ -310,6 +636,1124 @@ TEST_CASE("encrypt_short and decrypt_long pair works", "[d88::encrypt]")
     REQUIRE_THAT(plain, Catch::Matchers::Equals(plain2));
 }
 
+template <typename T> void multi_block_matches_single(const std::vector<T>& sym)
+{
+    constexpr size_t S = 64;
+    constexpr size_t blocks = 37;
+
+    auto plain = d8u::random::Vector<T>(S * blocks);
+
+    std::vector<T> sym2(sym);
+    EncryptContextLong<T, S> ec(sym2);
+    DecryptContextShort<T, S> dc(sym2);
+    DecryptContextLong<T, S> dl(sym2);
+
+    std::vector<T> temp(S), result(S * blocks);
+    std::vector<T> enc(S * blocks), dec_short(S * blocks), dec_long(S * blocks);
+
+    for (size_t b = 0; b < blocks; b++)
+    {
+        block_encrypt_long<T, S>(span<T>(plain).subspan(b * S, S), temp, span<T>(enc).subspan(b * S, S), ec);
+        block_decrypt_short<T, S>(span<T>(plain).subspan(b * S, S), span<T>(dec_short).subspan(b * S, S), dc);
+        block_decrypt_long<T, S>(span<T>(plain).subspan(b * S, S), temp, span<T>(dec_long).subspan(b * S, S), dl);
+    }
+
+    for (int isa = (int)simd::isa_t::scalar; isa <= (int)simd::detected; isa++)
+    {
+        simd::Select((simd::isa_t)isa);
+
+        multi_block_encrypt_long<T, S>(plain, result, ec);
+        REQUIRE_THAT(enc, Catch::Matchers::Equals(result));
+
+        multi_block_decrypt_short<T, S>(plain, result, dc);
+        REQUIRE_THAT(dec_short, Catch::Matchers::Equals(result));
+
+        multi_block_decrypt_long<T, S>(plain, result, dl);
+        REQUIRE_THAT(dec_long, Catch::Matchers::Equals(result));
+    }
+
+    simd::Select(simd::detected);
+}
+
+TEST_CASE("multi block encrypt/decrypt match single blocks", "[d88::encrypt]")
+{
+    multi_block_matches_single<uint64_t>(StringAsSymmetry<uint64_t, 64>("PASSWORD"));
+    multi_block_matches_single<uint32_t>(StringAsSymmetry<uint32_t, 64>("PASSWORD"));
+
+    auto plain = d8u::random::Vector<uint64_t>(64 * 8), enc = plain, dec = plain;
+
+    auto sym = StringAsSymmetry<uint64_t, 64>("PASSWORD");
+    EncryptContextLong<uint64_t, 64> ec(sym);
+    DecryptContextShort<uint64_t, 64> dc(sym);
+
+    multi_block_encrypt_long<uint64_t, 64>(plain, enc, ec);
+    multi_block_decrypt_short<uint64_t, 64>(enc, dec, dc);
+
+    REQUIRE_THAT(plain, Catch::Matchers::Equals(dec));
+
+    auto unit = StringAsSymmetry<uint64_t, 64>("PASSWORD");
+    unit[0] = 0;
+
+    multi_block_matches_single<uint64_t>(unit);
+}
+
+TEST_CASE("chunk loops run without heap allocations", "[d88::api]")
+{
+    using T = uint64_t;
+
+    options_t serial{ 1 };
+
+    auto large = d8u::random::Vector<uint8_t>(4096 * 64 + 100);
+    std::vector<uint8_t> small(large.begin(), large.begin() + 4096 * 4 + 100);
+
+    auto large_check = protect_block(large, serial);
+    auto small_check = protect_block(small, serial);
+
+    //After one warm call the only allocation left is the returned parity, whatever the chunk count:
+    //
+
+    size_t protect_small = CountAllocations([&]() { protect_block(small, serial); });
+    size_t protect_large = CountAllocations([&]() { protect_block(large, serial); });
+
+    recover_block(small, small_check, serial);
+
+    size_t recover_small = CountAllocations([&]() { recover_block(small, small_check, serial); });
+    size_t recover_large = CountAllocations([&]() { recover_block(large, large_check, serial); });
+
+    REQUIRE(protect_small == 1);
+    REQUIRE(protect_large == 1);
+    REQUIRE(recover_small == 0);
+    REQUIRE(recover_large == 0);
+
+    //Multi chunk encrypt/decrypt and a repair draw only from the thread's arena:
+    //
+
+    auto sym = StringAsSymmetry<T, 128>("PASSWORD");
+    d88::security::EncryptContextLong<T, 128> ec(sym);
+    d88::security::DecryptContextShort<T, 128> dc(sym);
+
+    auto plain = d8u::random::Vector<T>(128 * 40), enc = plain, dec = plain;
+
+    multi_block_encrypt_long<T, 128>(plain, enc, ec);
+    multi_block_decrypt_short<T, 128>(enc, dec, dc);
+
+    size_t crypt = CountAllocations([&]()
+    {
+        multi_block_encrypt_long<T, 128>(plain, enc, ec);
+        multi_block_decrypt_short<T, 128>(enc, dec, dc);
+    });
+
+    REQUIRE(crypt == 0);
+    REQUIRE_THAT(plain, Catch::Matchers::Equals(dec));
+
+    constexpr size_t S = 64;
+
+    auto data = d8u::random::Vector<T>(S), rsym = d8u::random::Vector<T>(S);
+    std::vector<T> ex(2), temp(S);
+
+    ImmutableShortContext<T, S, 2> ectx(rsym);
+    RecoverShortContext<T, S, 2> rctx(rsym);
+
+    immutable_extend_short<T, S, 2>(data, temp, ex, ectx);
+
+    auto dx = GenerateSequence<T>(S);
+    dx[10] = S;
+    dx[11] = S + 1;
+
+    auto broken = data;
+    broken[10] = ex[0];
+    broken[11] = ex[1];
+
+    auto repaired = broken;
+    recover_short<T, S, 2>(repaired, dx, rctx);
+
+    repaired = broken;
+    size_t repair = CountAllocations([&]() { recover_short<T, S, 2>(repaired, dx, rctx); });
+
+    REQUIRE(repair == 0);
+    REQUIRE_THAT(data, Catch::Matchers::Equals(repaired));
+}
+
+TEST_CASE("stream encrypt/decrypt match mapped files", "[d88::api]")
+{
+    constexpr size_t chunk = 1024;
+
+    for (size_t buffer : { 3 * chunk, 8 * chunk })
+    {
+        options_t options{ 0, false, 0, buffer };
+
+        for (auto name : { "testdata/small_file", "testdata/aligned_file" })
+        {
+            stream_encrypt(name, "testdata/stream_enc", "TESTPASSWORD", options);
+            default_decrypt("testdata/stream_enc", "testdata/stream_dec", "TESTPASSWORD");
+
+            CHECK(compare_files_bytes(name, "testdata/stream_dec"));
+
+            default_encrypt(name, "testdata/mapped_enc", "TESTPASSWORD");
+            stream_decrypt("testdata/mapped_enc", "testdata/stream_dec", "TESTPASSWORD", options);
+
+            CHECK(compare_files_bytes(name, "testdata/stream_dec"));
+
+            stream_decrypt("testdata/stream_enc", "testdata/stream_dec", "TESTPASSWORD", options);
+
+            CHECK(compare_files_bytes(name, "testdata/stream_dec"));
+
+            //Whole chunks are deterministic, only the random padding differs:
+            //
+
+            {
+                mio::mmap_source plain(name), streamed("testdata/stream_enc"), mapped("testdata/mapped_enc");
+
+                REQUIRE(streamed.size() == mapped.size());
+                CHECK(std::equal(streamed.begin(), streamed.begin() + plain.size() / chunk * chunk, mapped.begin()));
+            }
+        }
+    }
+
+    std::filesystem::remove_all("testdata/stream_enc");
+    std::filesystem::remove_all("testdata/stream_dec");
+    std::filesystem::remove_all("testdata/mapped_enc");
+}
+
+TEST_CASE("direct streams match mapped files", "[d88::api]")
+{
+    constexpr size_t chunk = 1024;
+
+    for (size_t buffer : { size_t(0), 4 * chunk })
+    {
+        options_t options{ 0, false, 0, buffer, true };
+
+        for (auto name : { "testdata/small_file", "testdata/aligned_file" })
+        {
+            default_encrypt(name, "testdata/direct_enc", "TESTPASSWORD", options);
+            default_decrypt("testdata/direct_enc", "testdata/direct_dec", "TESTPASSWORD");
+
+            CHECK(compare_files_bytes(name, "testdata/direct_dec"));
+
+            default_encrypt(name, "testdata/mapped_enc", "TESTPASSWORD");
+            default_decrypt("testdata/mapped_enc", "testdata/direct_dec", "TESTPASSWORD", options);
+
+            CHECK(compare_files_bytes(name, "testdata/direct_dec"));
+
+            default_protect(name, "testdata/direct_par", options);
+            default_protect(name, "testdata/mapped_par");
+
+            CHECK(compare_files_bytes("testdata/direct_par", "testdata/mapped_par"));
+        }
+    }
+
+    std::filesystem::remove_all("testdata/direct_enc");
+    std::filesystem::remove_all("testdata/direct_dec");
+    std::filesystem::remove_all("testdata/direct_par");
+    std::filesystem::remove_all("testdata/mapped_enc");
+    std::filesystem::remove_all("testdata/mapped_par");
+}
+
+TEST_CASE("buffer api round trips without files", "[d88::api]")
+{
+    for (size_t size : { size_t(1000), size_t(4096 * 3), size_t(4096 * 3 + 100) })
+    {
+        auto plain = d8u::random::Vector<uint8_t>(size);
+
+        std::vector<uint8_t> enc(encrypted_size(size));
+        encrypt_buffer(plain, enc, "TESTPASSWORD");
+
+        std::vector<uint8_t> dec(decrypted_size(enc));
+        decrypt_buffer(enc, dec, "TESTPASSWORD");
+
+        CHECK_THAT(dec, Catch::Matchers::Equals(plain));
+
+        std::vector<uint8_t> parity(protected_size(size));
+        protect_buffer(plain, parity);
+
+        CHECK_THAT(parity, Catch::Matchers::Equals(protect_block(plain)));
+        CHECK(verify_buffer(plain, parity));
+
+        auto damaged = plain;
+        damaged[size / 2] ^= 0x5a;
+
+        CHECK(!verify_buffer(damaged, parity));
+        CHECK(recover_buffer(damaged, parity));
+        CHECK(verify_buffer(damaged, parity));
+        CHECK_THAT(damaged, Catch::Matchers::Equals(plain));
+
+        CHECK_THROWS(encrypt_buffer(plain, gsl::span<uint8_t>(enc.data(), enc.size() - 1), "TESTPASSWORD"));
+        CHECK_THROWS(protect_buffer(plain, gsl::span<uint8_t>(parity.data(), parity.size() - 1)));
+    }
+}
+
+TEST_CASE("buffer api accepts spans at any byte offset", "[d88::api]")
+{
+    //Sub-spans one byte into a packet buffer, every side goes through the staged path:
+    //
+
+    auto shifted = [](size_t n) { return std::vector<uint8_t>(n + 1); };
+    auto at = [](std::vector<uint8_t>& v) { return gsl::span<uint8_t>(v.data() + 1, v.size() - 1); };
+
+    for (size_t size : { size_t(1024 * 40), size_t(1024 * 40 + 100) })
+    {
+        auto plain = d8u::random::Vector<uint8_t>(size);
+
+        auto src = shifted(size);
+        std::copy(plain.begin(), plain.end(), at(src).begin());
+
+        std::vector<uint8_t> enc(encrypted_size(size));
+        encrypt_buffer(plain, enc, "TESTPASSWORD");
+
+        auto enc1 = shifted(enc.size());
+        encrypt_buffer(at(src), at(enc1), "TESTPASSWORD");
+
+        //Only the random tail padding differs between the two encryptions:
+        auto cipher = at(enc1);
+        CHECK(std::equal(enc.begin(), enc.begin() + size / 1024 * 1024, cipher.begin()));
+
+        auto dec1 = shifted(size);
+        decrypt_buffer(at(enc1), at(dec1), "TESTPASSWORD");
+        CHECK(std::equal(plain.begin(), plain.end(), at(dec1).begin()));
+
+        for (size_t profile : { size_t(0), size_t(2) })
+        {
+            options_t options;
+            options.profile = profile;
+
+            std::vector<uint8_t> parity(protected_size(size, profile));
+            protect_buffer(plain, parity, options);
+
+            auto parity1 = shifted(parity.size());
+            protect_buffer(at(src), at(parity1), options);
+            CHECK(std::equal(parity.begin(), parity.end(), at(parity1).begin()));
+
+            CHECK(verify_buffer(at(src), at(parity1), options));
+
+            auto damaged = shifted(size);
+            std::copy(plain.begin(), plain.end(), at(damaged).begin());
+            at(damaged)[size / 2] ^= 0x5a;
+
+            CHECK(!verify_buffer(at(damaged), at(parity1), options));
+            CHECK(recover_buffer(at(damaged), at(parity1), options));
+            CHECK(std::equal(plain.begin(), plain.end(), at(damaged).begin()));
+
+            at(damaged)[7] ^= 1;
+            CHECK(reprotect_buffer(at(damaged), at(parity1), options) == 1);
+            CHECK(verify_buffer(at(damaged), at(parity1), options));
+        }
+    }
+}
+
+TEST_CASE("reprotect patches only changed chunks", "[d88::api]")
+{
+    constexpr size_t chunk = 4096;
+
+    auto data = d8u::random::Vector<uint8_t>(chunk * 16 + 100);
+
+    std::vector<uint8_t> parity(protected_size(data.size()));
+    protect_buffer(data, parity);
+
+    REQUIRE(reprotect_buffer(data, parity) == 0);
+
+    data[chunk * 3 + 7] ^= 1;
+    data[chunk * 9] ^= 1;
+    data[data.size() - 1] ^= 1;
+
+    auto scanned = parity;
+    REQUIRE(reprotect_buffer(data, scanned) == 3);
+    CHECK_THAT(scanned, Catch::Matchers::Equals(protect_block(data)));
+
+    auto ranged = parity;
+    REQUIRE(reprotect_buffer(data, ranged, byte_ranges{ { chunk * 3 + 7, 1 }, { chunk * 9 - 2, 3 }, { data.size() - 1, 1 } }) == 3);
+    CHECK_THAT(ranged, Catch::Matchers::Equals(scanned));
+
+    //The scan checks every parity word, a flip in a recovery word is rebuilt as well as one in a validation word:
+    //
+
+    auto stale = scanned;
+    stale[5 * 128] ^= 1;
+
+    CHECK(reprotect_buffer(data, stale) == 1);
+    CHECK_THAT(stale, Catch::Matchers::Equals(scanned));
+
+    stale[5 * 128 + 14 * 8] ^= 1;
+
+    CHECK(reprotect_buffer(data, stale) == 1);
+    CHECK_THAT(stale, Catch::Matchers::Equals(scanned));
+
+    //A top bit change in a data word leaves any row with an even coefficient for that column unchanged, every column is caught by some row:
+    //
+
+    for (size_t j = 0; j < chunk / 8; j += 37)
+    {
+        auto edited = data;
+        edited[chunk * 11 + j * 8 + 7] ^= 0x80;
+
+        auto patched = scanned;
+        CHECK(reprotect_buffer(edited, patched) == 1);
+        CHECK_THAT(patched, Catch::Matchers::Equals(protect_block(edited)));
+    }
+
+    //Range lists load from offset length pairs:
+    //
+
+    {
+        std::ofstream ofs("testdata/reprotect_ranges");
+        ofs << chunk * 3 + 7 << " 1\n" << chunk * 9 - 2 << " 3\n";
+    }
+
+    CHECK(load_byte_ranges("testdata/reprotect_ranges") == byte_ranges{ { chunk * 3 + 7, 1 }, { chunk * 9 - 2, 3 } });
+
+    {
+        std::ofstream ofs("testdata/reprotect_ranges");
+        ofs << "12 x";
+    }
+
+    CHECK_THROWS(load_byte_ranges("testdata/reprotect_ranges"));
+    std::filesystem::remove_all("testdata/reprotect_ranges");
+
+    //Files that grow or shrink get their parity resized and the new tail filled:
+    //
+
+    std::vector<uint8_t> grown(data);
+    grown.resize(chunk * 20 + 5, 0x33);
+
+    for (auto size : { data.size(), grown.size(), chunk * 7 + 9 })
+    {
+        {
+            std::ofstream ofs("testdata/reprotect_file", std::ios::binary);
+            ofs.write((const char*)grown.data(), size);
+        }
+
+        default_reprotect("testdata/reprotect_file", "testdata/reprotect_par", byte_ranges());
+
+        auto expected = protect_block(std::vector<uint8_t>(grown.begin(), grown.begin() + size));
+        mio::mmap_source check("testdata/reprotect_par");
+
+        REQUIRE(check.size() == parity_alignment + expected.size());
+        CHECK(std::equal(check.begin() + parity_alignment, check.end(), (const char*)expected.data()));
+    }
+
+    std::filesystem::remove_all("testdata/reprotect_file");
+    std::filesystem::remove_all("testdata/reprotect_par");
+}
+
+TEST_CASE("verify marks corrupt chunks without writing", "[d88::api]")
+{
+    constexpr size_t chunk = 4096;
+
+    auto data = d8u::random::Vector<uint8_t>(chunk * 130 + 10);
+    auto parity = protect_block(data);
+
+    auto clean = verify_chunks(data, parity, options_t{ 0, false, 3 });
+
+    REQUIRE(clean.chunks == 131);
+    REQUIRE(clean.Count() == 0);
+
+    for (size_t i : { size_t(0), size_t(63), size_t(64), size_t(65), size_t(130) })
+        data[i * chunk + 5] ^= 1;
+
+    auto original = data;
+    auto bad = verify_chunks(data, parity, options_t{ 0, false, 3 });
+
+    REQUIRE(bad.Count() == 5);
+    CHECK(bad.Test(0));
+    CHECK(bad.Test(130));
+    CHECK(!bad.Test(1));
+    CHECK(bad.Runs() == std::vector<std::pair<size_t, size_t>>{ { 0, 1 }, { 63, 3 }, { 130, 1 } });
+    CHECK_THAT(data, Catch::Matchers::Equals(original));
+
+    {
+        std::ofstream ofs("testdata/verify_file", std::ios::binary);
+        ofs.write((const char*)data.data(), data.size());
+    }
+
+    {
+        std::ofstream ofs("testdata/verify_par", std::ios::binary);
+        ofs.write((const char*)parity.data(), parity.size());
+    }
+
+    CHECK(default_verify("testdata/verify_file", "testdata/verify_par").bits == bad.bits);
+
+    std::filesystem::remove_all("testdata/verify_file");
+    std::filesystem::remove_all("testdata/verify_par");
+}
+
+TEST_CASE("repair plan matches row_solve window repairs", "[d88::correct]")
+{
+    static const size_t S = 64;
+    static const size_t E = 3;
+    static const size_t C = 2;
+    typedef unsigned long long T;
+
+    auto data = d8u::random::Vector<T>(S);
+    auto sym = d8u::random::Vector<T>(S);
+
+    std::vector<T> ex(E + C), ex_temp(E + C), temp1(S), temp2(S);
+
+    ImmutableShortContext<T, S, E> ectx(sym);
+    RepairPlan<T, S, E, C> plan(sym);
+
+    immutable_extend_short<T, S, E, C>(data, temp1, ex, ectx);
+
+    for (size_t at : { size_t(0), size_t(17), size_t(S - E - 1) })
+    {
+        auto a = data, b = data;
+
+        for (size_t j = 0; j < E; j++)
+            a[at + j] = b[at + j] = 0xfefefefefefefefe - j;
+
+        bool quick = repair_quick2<T, S, E, 1, C>(a, temp1, temp2, ex, ex_temp, sym, ectx);
+        bool planned = repair_quick2<T, S, E, 1, C>(b, temp1, temp2, ex, ex_temp, plan, ectx);
+
+        REQUIRE(quick);
+        REQUIRE(planned);
+        REQUIRE_THAT(a, Catch::Matchers::Equals(data));
+        REQUIRE_THAT(b, Catch::Matchers::Equals(data));
+    }
+
+    auto sporadic = data;
+    sporadic[1] = sporadic[9] = sporadic[15] = 0xfefefefefefefefe;
+
+    REQUIRE(!repair_quick2<T, S, E, 1, C>(sporadic, temp1, temp2, ex, ex_temp, plan, ectx));
+}
+
+TEST_CASE("recover spreads windows of few bad chunks over the pool", "[d88::api]")
+{
+    constexpr size_t chunk = 4096;
+
+    auto data = d8u::random::Vector<uint8_t>(chunk * 12 + 300);
+    auto parity = protect_block(data);
+
+    for (size_t threads : { size_t(1), size_t(4) })
+    {
+        options_t options{ threads };
+
+        //One chunk is fewer than 4 workers and takes the spread path, six are shared out a chunk per task:
+        //
+
+        for (size_t bad : { size_t(1), size_t(6) })
+        {
+            auto damaged = data;
+
+            for (size_t k = 0; k < bad; k++)
+                for (size_t j = 0; j < 24; j++)
+                    damaged[(k * 2) * chunk + 1000 + j] ^= 0xa5;
+
+            CHECK(recover_buffer(damaged, parity, options));
+            CHECK_THAT(damaged, Catch::Matchers::Equals(data));
+        }
+
+        auto hopeless = data;
+
+        for (size_t j = 0; j < 400; j += 40)
+            hopeless[chunk * 5 + j * 8] ^= 0xff;
+
+        CHECK(!recover_buffer(hopeless, parity, options));
+        CHECK(verify_chunks(hopeless, parity, options).Count() == 1);
+    }
+}
+
+TEST_CASE("syndrome locator repairs scattered words", "[d88::correct]")
+{
+    static const size_t S = 64;
+    static const size_t E = 3;
+    static const size_t C = 2;
+    typedef unsigned long long T;
+
+    auto data = d8u::random::Vector<T>(S);
+    auto sym = d8u::random::Vector<T>(S);
+
+    std::vector<T> ex(E + C), ex_temp(E + C), temp1(S), temp2(S);
+
+    ImmutableShortContext<T, S, E> ectx(sym);
+    RepairPlan<T, S, E, C> plan(sym);
+
+    immutable_extend_short<T, S, E, C>(data, temp1, ex, ectx);
+
+    auto single = data;
+    single[S - 1] = 0x1234;
+
+    REQUIRE(repair_scattered<T, S, E, C>(1, single, temp1, temp2, ex, ex_temp, plan, ectx));
+    REQUIRE_THAT(single, Catch::Matchers::Equals(data));
+
+    //Too far apart for any window:
+    //
+
+    auto pair = data;
+    pair[3] = 0xfefefefefefefefe;
+    pair[50] = 0x77;
+
+    REQUIRE(!repair_quick2<T, S, E, 1, C>(pair, temp1, temp2, ex, ex_temp, plan, ectx));
+    REQUIRE(!repair_scattered<T, S, E, C>(1, pair, temp1, temp2, ex, ex_temp, plan, ectx));
+    REQUIRE(repair_locate<T, S, E, C>(pair, temp1, temp2, ex, ex_temp, plan, ectx));
+    REQUIRE_THAT(pair, Catch::Matchers::Equals(data));
+
+    auto burst = data;
+    burst[20] = burst[21] = burst[22] = 0xfcfcfcfcfcfcfcfc;
+
+    REQUIRE(repair_locate<T, S, E, C>(burst, temp1, temp2, ex, ex_temp, plan, ectx));
+    REQUIRE_THAT(burst, Catch::Matchers::Equals(data));
+
+    auto sporadic = data;
+    sporadic[1] = sporadic[9] = sporadic[40] = 0xfefefefefefefefe;
+
+    REQUIRE(!repair_locate<T, S, E, C>(sporadic, temp1, temp2, ex, ex_temp, plan, ectx));
+
+    //Pairs are found from the syndrome's low bits whether both errors reach the lowest bit or only one does.
+    //Any two columns that differ mod 2 over the plan's rows are solvable:
+    //
+
+    auto low_bits = [&](size_t j)
+    {
+        size_t m = 0;
+
+        for (size_t k = 0; k < E + C; k++)
+            m |= size_t(plan.Row(k)[j] & 1) << k;
+
+        return m;
+    };
+
+    size_t found = 0;
+
+    for (size_t a = 0; a < S; a += 5)
+    {
+        for (size_t b = a + 7; b < S; b += 11)
+        {
+            if (!low_bits(a) || !low_bits(b) || low_bits(a) == low_bits(b))
+                continue;
+
+            for (T shift : { T(0), T(3) })
+            {
+                auto scattered = data;
+                scattered[a] += T(0x35) << shift;
+                scattered[b] += 0x1001;
+
+                REQUIRE(repair_scattered<T, S, E, C>(2, scattered, temp1, temp2, ex, ex_temp, plan, ectx));
+                REQUIRE_THAT(scattered, Catch::Matchers::Equals(data));
+
+                found++;
+            }
+        }
+    }
+
+    REQUIRE(found > 0);
+
+    //The same through the api, two words at opposite ends of one 4KiB chunk:
+    //
+
+    auto file = d8u::random::Vector<uint8_t>(4096 * 3);
+    auto parity = protect_block(file);
+    auto damaged = file;
+
+    damaged[4096 + 8] ^= 0x10;
+    damaged[4096 * 2 - 16] ^= 0x01;
+
+    REQUIRE(recover_buffer(damaged, parity));
+    REQUIRE_THAT(damaged, Catch::Matchers::Equals(file));
+}
+
+TEST_CASE("dense LU solves and inverts mod 2^w", "[d88::correct]")
+{
+    auto check = [](auto zero, size_t n)
+    {
+        using T = decltype(zero);
+
+        //A random matrix is invertible mod 2 about 29% of the time:
+        //
+
+        std::vector<T> a;
+        DenseLU<T> lu;
+
+        do
+        {
+            a = d8u::random::Vector<T>(n * n);
+        } while (!lu.Factor(a.data(), n, n));
+
+        auto x = d8u::random::Vector<T>(n);
+        std::vector<T> b(n, 0), inv(n * n);
+
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                b[i] += a[i * n + j] * x[j];
+
+        lu.Solve(b.data());
+        REQUIRE_THAT(b, Catch::Matchers::Equals(x));
+
+        lu.Inverse(inv.data());
+
+        bool identity = true;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t j = 0; j < n; j++)
+            {
+                T sum = 0;
+
+                for (size_t k = 0; k < n; k++)
+                    sum += inv[i * n + k] * a[k * n + j];
+
+                identity &= (sum == T(i == j));
+            }
+        }
+
+        REQUIRE(identity);
+
+        //Two equal rows are singular mod 2:
+        //
+
+        std::copy(a.begin(), a.begin() + n, a.begin() + (n - 1) * n);
+
+        if (n > 1)
+            REQUIRE(!lu.Factor(a.data(), n, n));
+    };
+
+    for (size_t n : { 1, 14, 33, 100 })
+    {
+        check(uint64_t(0), n);
+        check(uint32_t(0), n);
+        check(uint16_t(0), n);
+    }
+}
+
+TEST_CASE("protection profiles round trip and record themselves", "[d88::api]")
+{
+    for (size_t id = 0; id < profile_count; id++)
+    {
+        auto profile = describe_profile(id);
+
+        options_t options;
+        options.profile = id;
+
+        auto data = d8u::random::Vector<uint8_t>(profile.chunk * 3 + 100);
+        auto parity = protect_block(data, options);
+
+        REQUIRE(parity.size() == 4 * profile.parity);
+        REQUIRE(verify_buffer(data, parity, options));
+
+        //A burst as long as every stripe can take together, mid chunk, plus a flipped byte in the padded tail:
+        //
+
+        auto damaged = data;
+        size_t burst = profile.stripes * profile.rec * profile.word;
+
+        for (size_t k = 0; k < burst; k++)
+            damaged[profile.chunk + profile.chunk / 4 + k] ^= 0xa5;
+
+        damaged[data.size() - 3] ^= 1;
+
+        auto bad = verify_chunks(damaged, parity, options);
+
+        CHECK(bad.chunk == profile.chunk);
+        CHECK(bad.Runs() == std::vector<std::pair<size_t, size_t>>{ { 1, 1 }, { 3, 1 } });
+
+        REQUIRE(recover_buffer(damaged, parity, options));
+        REQUIRE_THAT(damaged, Catch::Matchers::Equals(data));
+    }
+
+    //The default profile is the original layout and every other one differs from it:
+    //
+
+    auto data = d8u::random::Vector<uint8_t>(4096 * 4);
+
+    CHECK(protected_size(data.size()) == data.size() / 4096 * 128);
+    CHECK(protect_block(data, options_t{ 0, false, 0, 0, false, 2 }) != protect_block(data));
+    CHECK_THROWS(describe_profile(profile_count));
+    CHECK(find_profile("16k") == 2);
+
+    {
+        const char* argv[] = { "d88", "--gensym", "--profile", "16K" };
+        CHECK(d88::cli::run(4, const_cast<char**>(argv)) == 1);
+    }
+
+    //Files carry their profile, recover and verify take it from the header whatever the options say:
+    //
+
+    {
+        std::ofstream ofs("testdata/profile_file", std::ios::binary);
+        ofs.write((const char*)data.data(), data.size());
+    }
+
+    default_protect("testdata/profile_file", "testdata/profile_par", options_t{ 0, false, 0, 0, false, find_profile("1k") });
+
+    {
+        std::fstream fs("testdata/profile_file", std::ios::binary | std::ios::in | std::ios::out);
+        fs.seekp(5000);
+        fs.write("damage", 6);
+    }
+
+    CHECK(default_verify("testdata/profile_file", "testdata/profile_par").Runs() == std::vector<std::pair<size_t, size_t>>{ { 4, 1 } });
+
+    default_recover("testdata/profile_file", "testdata/profile_par");
+
+    {
+        mio::mmap_source repaired("testdata/profile_file");
+        CHECK(std::equal(repaired.begin(), repaired.end(), (const char*)data.data()));
+    }
+
+    CHECK(default_verify("testdata/profile_file", "testdata/profile_par").Count() == 0);
+
+    std::filesystem::remove_all("testdata/profile_file");
+    std::filesystem::remove_all("testdata/profile_par");
+}
+
+TEST_CASE("parity files describe themselves and reject mismatches", "[d88::api]")
+{
+    auto data = d8u::random::Vector<uint8_t>(4096 * 5 + 300);
+
+    {
+        std::ofstream ofs("testdata/header_file", std::ios::binary);
+        ofs.write((const char*)data.data(), data.size());
+    }
+
+    default_protect("testdata/header_file", "testdata/header_par");
+
+    auto records = protect_block(data);
+
+    {
+        mio::mmap_source raw("testdata/header_par");
+        parity_header h;
+        std::memcpy(&h, raw.data(), sizeof(h));
+
+        CHECK(h.version == parity_version);
+        CHECK(h.profile == 0);
+        CHECK(h.header_size == parity_alignment);
+        CHECK(h.record_size == 128);
+        CHECK(h.size == data.size());
+        CHECK(h.chunks == 6);
+        CHECK(h.padding == 4096 - 300);
+        CHECK(raw.size() == parity_alignment + records.size());
+
+        parity_file check("testdata/header_par", data.size());
+
+        CHECK(check.Profile() == 0);
+        CHECK((size_t)check.Records().data() % parity_alignment == 0);
+        CHECK(std::equal(check.Record(4).begin(), check.Record(4).end(), records.begin() + 4 * 128));
+
+        //Wrong data, wrong length and a foreign symmetry are all caught from the header:
+        //
+
+        gsl::span<const uint8_t> bytes((const uint8_t*)raw.data(), raw.size());
+        std::vector<uint8_t> copy(bytes.begin(), bytes.end());
+
+        CHECK_THROWS(parity_layout(bytes, data.size() + 1));
+        CHECK_THROWS(parity_layout(bytes.first(bytes.size() - 1), data.size()));
+
+        copy[offsetof(parity_header, digest)] ^= 1;
+        CHECK_THROWS(parity_layout(copy, data.size()));
+
+        copy[offsetof(parity_header, digest)] ^= 1;
+        copy[offsetof(parity_header, version)] = 9;
+        CHECK_THROWS(parity_layout(copy, data.size()));
+    }
+
+    {
+        std::ofstream ofs("testdata/header_other", std::ios::binary);
+        ofs.write((const char*)data.data(), data.size() - 1);
+    }
+
+    CHECK_THROWS(default_verify("testdata/header_other", "testdata/header_par"));
+    CHECK_THROWS(default_recover("testdata/header_other", "testdata/header_par"));
+
+    //The command line reports the mismatch and fails instead of aborting:
+    //
+
+    for (const char* op : { "--verify", "--recover" })
+    {
+        const char* argv[] = { "d88", op, "-i", "testdata/header_other", "-o", "testdata/header_par" };
+        CHECK(d88::cli::run(6, const_cast<char**>(argv)) == 1);
+    }
+
+    //Re-protecting a shrunk file restamps the header:
+    //
+
+    std::filesystem::resize_file("testdata/header_file", 4096 * 2);
+    default_reprotect("testdata/header_file", "testdata/header_par");
+
+    CHECK(default_verify("testdata/header_file", "testdata/header_par").chunks == 2);
+
+    //A header that stops short of a full one is refused, only bare records are read without it:
+    //
+
+    {
+        std::ofstream ofs("testdata/header_par", std::ios::binary);
+        parity_header h;
+
+        ofs.write((const char*)&h, 16);
+        ofs.write((const char*)records.data(), 2 * 128);
+    }
+
+    CHECK_THROWS(default_verify("testdata/header_file", "testdata/header_par"));
+
+    {
+        std::ofstream ofs("testdata/header_par", std::ios::binary);
+        ofs.write((const char*)records.data(), 2 * 128);
+    }
+
+    CHECK(default_verify("testdata/header_file", "testdata/header_par").Count() == 0);
+
+    std::filesystem::remove_all("testdata/header_file");
+    std::filesystem::remove_all("testdata/header_other");
+    std::filesystem::remove_all("testdata/header_par");
+}
+
+TEST_CASE("decrypt reader serves ranges without decrypting the file", "[d88::api]")
+{
+    auto plain = d8u::random::Vector<uint8_t>(1024 * 50 + 77);
+
+    std::vector<uint8_t> enc(encrypted_size(plain.size()));
+    encrypt_buffer(plain, enc, "TESTPASSWORD");
+
+    decrypt_reader reader(enc, "TESTPASSWORD", 4);
+
+    REQUIRE(reader.size() == plain.size());
+
+    auto check = [&](size_t offset, size_t n)
+    {
+        auto got = reader.Read(offset, n);
+        size_t expected = (offset < plain.size()) ? std::min(n, plain.size() - offset) : 0;
+
+        REQUIRE(got.size() == expected);
+        REQUIRE(std::equal(got.begin(), got.end(), plain.begin() + std::min(offset, plain.size())));
+    };
+
+    check(0, 10);
+    check(1020, 10);
+    check(1024 * 3, 1024 * 5);
+    check(777, 1024 * 20 + 3);
+    check(plain.size() - 100, 1000);
+    check(plain.size(), 10);
+    check(0, plain.size());
+
+    //Unaligned destinations stage whole chunks and read the same bytes:
+    //
+
+    std::vector<uint8_t> odd(1024 * 4 + 1);
+    REQUIRE(reader.Read(1024 * 2, gsl::span<uint8_t>(odd.data() + 1, odd.size() - 1)) == odd.size() - 1);
+    CHECK(std::equal(odd.begin() + 1, odd.end(), plain.begin() + 1024 * 2));
+
+    //A long read at an odd offset only takes its two partial chunks from the cache:
+    //
+
+    {
+        auto before = reader.Stats();
+
+        check(3, 1024 * 40);
+
+        auto after = reader.Stats();
+
+        CHECK((after.misses - before.misses) + (after.hits - before.hits) <= 2);
+        CHECK(after.misses - before.misses <= 2);
+    }
+
+    //Readers on several threads share one reader:
+    //
+
+    {
+        std::vector<std::thread> threads;
+        std::atomic<size_t> wrong = 0;
+
+        for (size_t t = 0; t < 4; t++)
+            threads.emplace_back([&, t]()
+            {
+                for (size_t r = 0; r < 20; r++)
+                {
+                    size_t at = (t * 7919 + r * 1237) % plain.size();
+                    auto got = reader.Read(at, 3000);
+
+                    if (!std::equal(got.begin(), got.end(), plain.begin() + at))
+                        wrong++;
+                }
+            });
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(wrong == 0);
+    }
+
+    //Small reads inside one chunk hit the cache after the first:
+    //
+
+    auto before = reader.Stats();
+
+    check(5000, 3);
+    check(5003, 3);
+    check(5006, 3);
+
+    auto after = reader.Stats();
+
+    CHECK(after.misses - before.misses <= 1);
+    CHECK(after.hits - before.hits >= 2);
+
+    //The file form maps the cipher and a short trailer is refused up front:
+    //
+
+    {
+        std::ofstream ofs("testdata/reader_enc", std::ios::binary);
+        ofs.write((const char*)enc.data(), enc.size());
+    }
+
+    decrypt_reader mapped("testdata/reader_enc", "TESTPASSWORD");
+
+    auto middle = mapped.Read(12345, 6789);
+    CHECK(std::equal(middle.begin(), middle.end(), plain.begin() + 12345));
+
+    CHECK_THROWS(decrypt_reader(gsl::span<const uint8_t>(enc.data(), enc.size() - 1), "TESTPASSWORD"));
+
+    std::filesystem::remove_all("testdata/reader_enc");
+}
+
+TEST_CASE("tweaked chunks round trip and hide repeated plain text", "[d88::api]")
+{
+    constexpr size_t chunk = 1024;
+
+    auto block = d8u::random::Vector<uint8_t>(chunk);
+    std::vector<uint8_t> plain;
+
+    for (size_t i = 0; i < 20; i++)
+        plain.insert(plain.end(), block.begin(), block.end());
+
+    plain.resize(plain.size() + 300, 7);
+
+    options_t tweaked;
+    tweaked.tweak = true;
+
+    std::vector<uint8_t> flat(encrypted_size(plain.size())), enc(flat.size()), dec(plain.size());
+
+    encrypt_buffer(plain, flat, "TESTPASSWORD");
+    encrypt_buffer(plain, enc, "TESTPASSWORD", tweaked);
+
+    //Untweaked equal chunks encrypt alike, tweaked ones do not:
+    //
+
+    CHECK(std::equal(flat.begin(), flat.begin() + chunk, flat.begin() + chunk));
+    CHECK(!std::equal(enc.begin(), enc.begin() + chunk, enc.begin() + chunk));
+    CHECK(!std::equal(enc.begin(), enc.begin() + chunk, flat.begin()));
+
+    decrypt_buffer(enc, dec, "TESTPASSWORD", tweaked);
+    CHECK(dec == plain);
+
+    decrypt_buffer(enc, dec, "TESTPASSWORD");
+    CHECK(dec != plain);
+
+    //Streams count chunks across slots, the reader from its offset:
+    //
+
+    {
+        std::ofstream ofs("testdata/tweak_plain", std::ios::binary);
+        ofs.write((const char*)plain.data(), plain.size());
+    }
+
+    options_t streamed = tweaked;
+    streamed.buffer = 3 * chunk;
+
+    stream_encrypt("testdata/tweak_plain", "testdata/tweak_enc", "TESTPASSWORD", streamed);
+
+    {
+        mio::mmap_source cipher("testdata/tweak_enc");
+
+        REQUIRE(cipher.size() == enc.size());
+        CHECK(std::equal(enc.begin(), enc.begin() + plain.size() / chunk * chunk, (const uint8_t*)cipher.data()));
+    }
+
+    stream_decrypt("testdata/tweak_enc", "testdata/tweak_dec", "TESTPASSWORD", streamed);
+    CHECK(compare_files_bytes("testdata/tweak_plain", "testdata/tweak_dec"));
+
+    decrypt_reader reader(enc, "TESTPASSWORD", 4, tweaked);
+
+    auto middle = reader.Read(chunk * 5 + 11, chunk * 9);
+    CHECK(std::equal(middle.begin(), middle.end(), plain.begin() + chunk * 5 + 11));
+
+    auto end = reader.Read(plain.size() - 500, 1000);
+    CHECK(std::equal(end.begin(), end.end(), plain.end() - 500));
+
+    std::filesystem::remove_all("testdata/tweak_plain");
+    std::filesystem::remove_all("testdata/tweak_enc");
+    std::filesystem::remove_all("testdata/tweak_dec");
+}
+
+TEST_CASE("difference table kernels match pascal triangle", "[d88::encrypt]")
+{
+    typedef unsigned long long T;
+    constexpr size_t S = 128;
+
+    auto data = d8u::random::Vector<T>(S);
+    auto pt = GeneratePascal<T, S>();
+
+    std::vector<T> a(S), b(S);
+
+    ToPascal<T>(data, a, pt);
+    ToPascalDifference<T>(data, b);
+    REQUIRE_THAT(a, Catch::Matchers::Equals(b));
+
+    ExecutePolarPascal<T>(data, a, pt);
+    ExecutePolarPascalDifference<T>(data, b);
+    REQUIRE_THAT(a, Catch::Matchers::Equals(b));
+
+    ToPascalR<T>(data, a, pt);
+    ToPascalDifferenceR<T>(data, b);
+    REQUIRE_THAT(a, Catch::Matchers::Equals(b));
+
+    ToPascalPolarR<T>(data, a, pt);
+    ToPascalPolarDifferenceR<T>(data, b);
+    REQUIRE_THAT(a, Catch::Matchers::Equals(b));
+
+    auto sym = StringAsSymmetry<T, S>("PASSWORD");
+    EncryptContextLong<T, S> ec(sym);
+    DecryptContextLong<T, S> dc(sym);
+    std::vector<T> temp(S), enc1(S), enc2(S);
+
+    block_encrypt_long<T, S>(data, temp, enc1, ec);
+    block_encrypt_long<T, S, true>(data, temp, enc2, ec);
+    REQUIRE_THAT(enc1, Catch::Matchers::Equals(enc2));
+
+    block_decrypt_long<T, S>(enc1, temp, a, dc);
+    block_decrypt_long<T, S, true>(enc1, temp, b, dc);
+    REQUIRE_THAT(a, Catch::Matchers::Equals(b));
+
+    ToPascalDifference<T>(data, a);
+    ExecutePolarPascalDifference<T>(a, b);
+    REQUIRE_THAT(data, Catch::Matchers::Equals(b));
+}
+
+template <typename T> void simd_pascal_matches_scalar(size_t S)
+{
+    PascalTriangle<T> pt(S);
+    auto data = d8u::random::Vector<T>(S);
+
+    std::vector<T> expect(S), result(S);
+
+    for (int f = 0; f < 4; f++)
+    {
+        for (int isa = (int)simd::isa_t::scalar; isa <= (int)simd::detected; isa++)
+        {
+            simd::Select((simd::isa_t)isa);
+
+            auto& out = (isa == (int)simd::isa_t::scalar) ? expect : result;
+
+            switch (f)
+            {
+            case 0: ToPascal<T>(data, out, pt); break;
+            case 1: ToPascalR<T>(data, out, pt); break;
+            case 2: ExecutePolarPascal<T>(data, out, pt); break;
+            case 3: ToPascalPolarR<T>(data, out, pt); break;
+            }
+
+            if (isa != (int)simd::isa_t::scalar)
+                REQUIRE_THAT(expect, Catch::Matchers::Equals(result));
+        }
+    }
+
+    simd::Select(simd::detected);
+}
+
+TEST_CASE("simd pascal kernels match scalar", "[d88::simd]")
+{
+    for (size_t S : { 1, 7, 16, 33, 128, 131 })
+    {
+        simd_pascal_matches_scalar<uint16_t>(S);
+        simd_pascal_matches_scalar<uint32_t>(S);
+        simd_pascal_matches_scalar<uint64_t>(S);
+    }
+}
+
 TEST_CASE("block_feedback_hash basically acts like a hash", "[d88::hash]")
 {
     auto data1 = d8u::random::Vector<unsigned long long>(64);